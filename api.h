@@ -20,6 +20,11 @@
 #ifndef API_H_
 #define API_H_
 
+struct api;
+
+/* Called for each device found by api->scan(), with api set up to access it */
+typedef int (*eeprom_found_fn)(struct api *api, void *ctx);
+
 struct api {
 	int fd;
 	int i2c_bus;
@@ -28,6 +33,8 @@ struct api {
 	int (*read)(struct api *api, unsigned char *buf, int offset, int size);
 	int (*write)(struct api *api, unsigned char *buf, int offset, int size);
 	int (*probe)(struct api *api);
+	int (*scan)(struct api *api, eeprom_found_fn found, void *ctx);
+	void (*close)(struct api *api);
 	void (*system_error)(const char *message);
 };
 
@@ -0,0 +1,3 @@
+#define VERSION "3.2.0"
+#define BUILD_DATE "18 Oct 2026"
+#define BUILD_TIME "10:02:08"
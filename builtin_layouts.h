@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2009-2017 CompuLab, Ltd.
+ * Authors: Nikita Kiryanov <nikita@compulab.co.il>
+ *	    Igor Grinberg <grinberg@compulab.co.il>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BUILTIN_LAYOUTS_
+#define _BUILTIN_LAYOUTS_
+
+#include "field.h"
+
+/*
+ * The fields of the built in layouts. Included by layout.c, and by
+ * gen_decoders.c, which generates the decoders of these layouts at build time.
+ */
+static const struct field_desc layout_legacy[5] = {
+	{ "MAC address",		"mac",	6,	FIELD_MAC,	0 },
+	{ "Board Revision",		"rev",	2,	FIELD_BINARY,	6 },
+	{ "Serial Number",		"sn",	8,	FIELD_BINARY,	8 },
+	{ "Board Configuration",	"conf",	64,	FIELD_ASCII,	16 },
+	{ "Reserved fields",		"rsvd",	176,	FIELD_RESERVED,	80 },
+};
+
+static const struct field_desc layout_v1[12] = {
+	{ "Major Revision",	"major",	2,	FIELD_VERSION,	0 },
+	{ "Minor Revision",	"minor",	2,	FIELD_VERSION,	2 },
+	{ "1st MAC Address",	"mac1",		6,	FIELD_MAC,	4 },
+	{ "2nd MAC Address",	"mac2",		6,	FIELD_MAC,	10 },
+	{ "Production Date",	"date",		4,	FIELD_DATE,	16 },
+	{ "Serial Number",	"sn",		12,	FIELD_REVERSED,	20 },
+	{ "Reserved fields",	"rsvd",		96,	FIELD_RESERVED,	32 },
+	{ "Product Name",	"name",		16,	FIELD_ASCII,	128 },
+	{ "Product Options #1",	"opt1",		16,	FIELD_ASCII,	144 },
+	{ "Product Options #2",	"opt2",		16,	FIELD_ASCII,	160 },
+	{ "Product Options #3",	"opt3",		16,	FIELD_ASCII,	176 },
+	{ "Reserved fields",	"rsvd",		64,	FIELD_RESERVED,	192 },
+};
+
+static const struct field_desc layout_v2[15] = {
+	{ "Major Revision",			"major",	2,	FIELD_VERSION,	0 },
+	{ "Minor Revision",			"minor",	2,	FIELD_VERSION,	2 },
+	{ "1st MAC Address",			"mac1",		6,	FIELD_MAC,	4 },
+	{ "2nd MAC Address",			"mac2",		6,	FIELD_MAC,	10 },
+	{ "Production Date",			"date",		4,	FIELD_DATE,	16 },
+	{ "Serial Number",			"sn",		12,	FIELD_REVERSED,	20 },
+	{ "3rd MAC Address (WIFI)",		"mac3",		6,	FIELD_MAC,	32 },
+	{ "4th MAC Address (Bluetooth)",	"mac4",		6,	FIELD_MAC,	38 },
+	{ "Layout Version",			"layout",	1,	FIELD_BINARY,	44 },
+	{ "Reserved fields",			"rsvd",		83,	FIELD_RESERVED,	45 },
+	{ "Product Name",			"name", 	16,	FIELD_ASCII,	128 },
+	{ "Product Options #1",			"opt1", 	16,	FIELD_ASCII,	144 },
+	{ "Product Options #2",			"opt2", 	16,	FIELD_ASCII,	160 },
+	{ "Product Options #3",			"opt3", 	16,	FIELD_ASCII,	176 },
+	{ "Reserved fields",			"rsvd",		64,	FIELD_RESERVED,	192 },
+};
+
+static const struct field_desc layout_v3[16] = {
+	{ "Major Revision",			"major",	2,	FIELD_VERSION,	0 },
+	{ "Minor Revision",			"minor",	2,	FIELD_VERSION,	2 },
+	{ "1st MAC Address",			"mac1",		6,	FIELD_MAC,	4 },
+	{ "2nd MAC Address",			"mac2",		6,	FIELD_MAC,	10 },
+	{ "Production Date",			"date",		4,	FIELD_DATE,	16 },
+	{ "Serial Number",			"sn",		12,	FIELD_REVERSED,	20 },
+	{ "3rd MAC Address (WIFI)",		"mac3",		6,	FIELD_MAC,	32 },
+	{ "4th MAC Address (Bluetooth)",	"mac4",		6,	FIELD_MAC,	38 },
+	{ "Layout Version",			"layout",	1,	FIELD_BINARY,	44 },
+	{ "CompuLab EEPROM ID",			"id",		3,	FIELD_BINARY,	45 },
+	{ "Reserved fields",			"rsvd",		80,	FIELD_RESERVED,	48 },
+	{ "Product Name",			"name",		16,	FIELD_ASCII,	128 },
+	{ "Product Options #1",			"opt1",		16,	FIELD_ASCII,	144 },
+	{ "Product Options #2",			"opt2",		16,	FIELD_ASCII,	160 },
+	{ "Product Options #3",			"opt3",		16,	FIELD_ASCII,	176 },
+	{ "Reserved fields",			"rsvd",		64,	FIELD_RESERVED,	192 },
+};
+
+static const struct field_desc layout_v4[21] = {
+	{ "Major Revision",			"major",	2,	FIELD_VERSION,	0 },
+	{ "Minor Revision",			"minor",	2,	FIELD_VERSION,	2 },
+	{ "1st MAC Address",			"mac1",		6,	FIELD_MAC,	4 },
+	{ "2nd MAC Address",			"mac2",		6,	FIELD_MAC,	10 },
+	{ "Production Date",			"date",		4,	FIELD_DATE,	16 },
+	{ "Serial Number",			"sn",		12,	FIELD_REVERSED,	20 },
+	{ "3rd MAC Address (WIFI)",		"mac3",		6,	FIELD_MAC,	32 },
+	{ "4th MAC Address (Bluetooth)",	"mac4",		6,	FIELD_MAC,	38 },
+	{ "Layout Version",			"layout",	1,	FIELD_BINARY,	44 },
+	{ "CompuLab EEPROM ID",			"id",		3,	FIELD_BINARY,	45 },
+	{ "5th MAC Address",			"mac5",		6,	FIELD_MAC,	48 },
+	{ "6th MAC Address",			"mac6",		6,	FIELD_MAC,	54 },
+	{ "Scratchpad",				"spad",		4,	FIELD_BINARY,	60 },
+	{ "Reserved fields",			"rsvd",		64,	FIELD_RESERVED,	64 },
+	{ "Product Name",			"name",		16,	FIELD_ASCII,	128 },
+	{ "Product Options #1",			"opt1",		16,	FIELD_ASCII,	144 },
+	{ "Product Options #2",			"opt2",		16,	FIELD_ASCII,	160 },
+	{ "Product Options #3",			"opt3",		16,	FIELD_ASCII,	176 },
+	{ "Product Options #4",			"opt4",		16,	FIELD_ASCII,	192 },
+	{ "Product Options #5",			"opt5",		16,	FIELD_ASCII,	208 },
+	{ "Reserved fields",			"rsvd",		32,	FIELD_RESERVED,	224 },
+};
+
+#endif
@@ -22,8 +22,22 @@
 #include <unistd.h>
 #include <malloc.h>
 #include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
 #include "command.h"
 #include "layout.h"
+#include "store.h"
+#include "inventory.h"
+#include "daemon.h"
+#include "shm.h"
+#include "journal.h"
+#include "counter.h"
+#include "custom_layout.h"
+#include "output.h"
+#include "json.h"
+#include "record.h"
 #include "api.h"
 
 static struct api api;
@@ -39,31 +53,1238 @@ static int read_eeprom(unsigned char *buf)
 	return ret;
 }
 
-static int write_eeprom(unsigned char *data)
+/*
+ * The fingerprint of an image: a few bytes which are expected to change when
+ * the contents of the EEPROM change, and the bytes its layout is detected by,
+ * so a stored layout version is only reused while they hold. Reading it
+ * instead of the entire image costs a small fraction of the bus time.
+ */
+#define MAX_FINGERPRINT_RANGES	8
+
+static struct bytes_range fingerprint[MAX_FINGERPRINT_RANGES];
+static int num_fingerprint_ranges;
+
+static void __attribute__((constructor)) build_fingerprint(void)
+{
+	bool mask[EEPROM_SIZE] = { false };
+
+	memset(mask + 16, true, 16);		/* production date, serial */
+	mark_detect_bytes(mask);
+
+	for (int i = 0; i < EEPROM_SIZE; i++) {
+		if (!mask[i])
+			continue;
+
+		ASSERT(num_fingerprint_ranges < MAX_FINGERPRINT_RANGES);
+		struct bytes_range *range = &fingerprint[num_fingerprint_ranges++];
+		range->start = i;
+		while (i + 1 < EEPROM_SIZE && mask[i + 1])
+			i++;
+
+		range->end = i;
+	}
+}
+
+/*
+ * read_fingerprint() - read only the fingerprint bytes into their offsets in
+ * buf. The rest of buf is left untouched.
+ */
+static int read_fingerprint(unsigned char *buf)
+{
+	for (int i = 0; i < num_fingerprint_ranges; i++) {
+		int size = fingerprint[i].end - fingerprint[i].start + 1;
+		if (api.read(&api, buf, fingerprint[i].start, size) < 0) {
+			api.system_error("Read error");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static bool fingerprint_matches(const unsigned char *a, const unsigned char *b)
+{
+	for (int i = 0; i < num_fingerprint_ranges; i++) {
+		int size = fingerprint[i].end - fingerprint[i].start + 1;
+		if (memcmp(a + fingerprint[i].start, b + fingerprint[i].start,
+			   size))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * init_api() - set up the api for accessing a device, either directly or via
+ * the daemon if a daemon socket was given.
+ */
+static void init_api(struct command *cmd, int i2c_bus, int i2c_addr)
+{
+	if (cmd->opts->socket_path)
+		daemon_api_init(&api, i2c_bus, i2c_addr,
+				cmd->opts->socket_path);
+	else
+		api_init(&api, i2c_bus, i2c_addr);
+}
+
+/*
+ * next_dirty_run() - find the next run of consecutive pages of data which
+ * differ from old
+ * @data:	The new image
+ * @old:	The image to compare with
+ * @from:	The page aligned offset to search from
+ * @size:	Where to save the size of the run
+ *
+ * Returns: the offset of the run, or -1 if there are no more dirty pages.
+ */
+static int next_dirty_run(const unsigned char *data, const unsigned char *old,
+			  int from, int *size)
+{
+	int start = from, end;
+
+	while (start < EEPROM_SIZE &&
+	       !memcmp(data + start, old + start, EEPROM_PAGE_SIZE))
+		start += EEPROM_PAGE_SIZE;
+
+	if (start >= EEPROM_SIZE)
+		return -1;
+
+	end = start + EEPROM_PAGE_SIZE;
+	while (end < EEPROM_SIZE &&
+	       memcmp(data + end, old + end, EEPROM_PAGE_SIZE))
+		end += EEPROM_PAGE_SIZE;
+
+	*size = end - start;
+	return start;
+}
+
+/*
+ * next_diff_run() - find the next run of consecutive bytes of data which
+ * differ from old
+ * @data:	The new image
+ * @old:	The image to compare with
+ * @from:	The offset to search from
+ * @end:	The offset to stop searching at
+ * @size:	Where to save the size of the run
+ *
+ * Returns: the offset of the run, or -1 if there are no more differing bytes.
+ */
+static int next_diff_run(const unsigned char *data, const unsigned char *old,
+			 int from, int end, int *size)
+{
+	int start = from, stop;
+
+	while (start < end && data[start] == old[start])
+		start++;
+
+	if (start >= end)
+		return -1;
+
+	for (stop = start + 1; stop < end && data[stop] != old[stop]; stop++)
+		;
+
+	*size = stop - start;
+	return start;
+}
+
+/*
+ * write_pending() - write the pending pages of a journal
+ * @journal:	The journal of the write
+ * @data:	The image to write
+ * @current:	The current contents of the EEPROM. Updated as pages are
+ *		written.
+ *
+ * Only the bytes which differ from the current contents are written. Each
+ * run of pending pages is marked as done in the journal once written.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int write_pending(struct journal *journal, unsigned char *data,
+			 unsigned char *current)
+{
+	int size, len;
+
+	for (int start = journal_next_pending(journal, 0, &size); start >= 0;
+	     start = journal_next_pending(journal, start + size, &size)) {
+		int end = start + size;
+
+		for (int i = next_diff_run(data, current, start, end, &len);
+		     i >= 0; i = next_diff_run(data, current, i + len, end, &len)) {
+			if (api.write(&api, data, i, len) < 0) {
+				api.system_error("Write error");
+				return -1;
+			}
+		}
+
+		memcpy(current + start, data + start, size);
+		if (journal_done(journal, start, size) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * find_non_blank() - find the first byte which isn't 0xff
+ *
+ * Compares a word at a time and looks for the byte only within the first
+ * word which differs.
+ *
+ * Returns: the offset of the byte, or -1 if all bytes are 0xff.
+ */
+static int find_non_blank(const unsigned char *data, int size)
+{
+	int i = 0;
+
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		if (word != UINT64_MAX)
+			break;
+	}
+
+	for (; i < size; i++)
+		if (data[i] != 0xff)
+			return i;
+
+	return -1;
+}
+
+/* The amount of bytes to check per read. One block read transaction. */
+#define READ_CHUNK 32
+
+/*
+ * blank_check() - check if the EEPROM is blank (all bytes are 0xff)
+ *
+ * The EEPROM is read in chunks, and reading stops at the first chunk which
+ * isn't blank.
+ *
+ * Returns: 0 if blank, -1 if not blank or on failure.
+ */
+static int blank_check(void)
+{
+	for (int i = 0; i < EEPROM_SIZE; i += READ_CHUNK) {
+		if (api.read(&api, buf, i, READ_CHUNK) < 0) {
+			api.system_error("Read error");
+			return -1;
+		}
+
+		int offset = find_non_blank(buf + i, READ_CHUNK);
+		if (offset >= 0) {
+			printf("EEPROM is not blank. First programmed byte at "
+			       "offset 0x%02x\n", i + offset);
+			return -1;
+		}
+	}
+
+	printf("EEPROM is blank\n");
+	return 0;
+}
+
+/*
+ * find_mismatch() - find the first byte which differs between a and b and
+ * isn't masked out (mask byte is 0)
+ *
+ * Returns: the offset of the byte, or -1 if there's no such byte.
+ */
+static int find_mismatch(const unsigned char *a, const unsigned char *b,
+			 const unsigned char *mask, int size)
+{
+	int i = 0;
+
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word_a, word_b, word_mask;
+		memcpy(&word_a, a + i, sizeof(word_a));
+		memcpy(&word_b, b + i, sizeof(word_b));
+		memcpy(&word_mask, mask + i, sizeof(word_mask));
+		if ((word_a ^ word_b) & word_mask)
+			break;
+	}
+
+	for (; i < size; i++)
+		if ((a[i] ^ b[i]) & mask[i])
+			return i;
+
+	return -1;
+}
+
+struct golden {
+	struct command *cmd;
+	struct layout *layout;
+	unsigned char image[EEPROM_SIZE];
+	unsigned char mask[EEPROM_SIZE];	/* 0 for ignored bytes */
+};
+
+/*
+ * load_golden() - load the golden image and build the mask of the bytes to
+ * compare. The names of the ignored fields are resolved using the layout of
+ * the golden image.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int load_golden(struct golden *golden)
+{
+	char *file_name = golden->cmd->opts->golden_file;
+	char *ignore = golden->cmd->opts->ignore_fields;
+
+	FILE *file = fopen(file_name, "r");
+	if (!file) {
+		eprintf("Failed opening %s: %s (%d)\n", file_name,
+			strerror(errno), -errno);
+		return -1;
+	}
+
+	int size = fread(golden->image, 1, EEPROM_SIZE, file);
+	bool too_long = fgetc(file) != EOF;
+	fclose(file);
+	if (size != EEPROM_SIZE || too_long) {
+		ieprintf("Golden image \"%s\" must be %d bytes", file_name,
+			 EEPROM_SIZE);
+		return -1;
+	}
+
+	golden->layout = new_layout(golden->image, EEPROM_SIZE,
+				    golden->cmd->opts->layout_ver,
+				    FORMAT_DEFAULT);
+	if (!golden->layout) {
+		api.system_error("Memory allocation error");
+		return -1;
+	}
+
+	memset(golden->mask, 0xff, EEPROM_SIZE);
+	for (char *name = ignore ? strtok(ignore, ",") : NULL; name;
+	     name = strtok(NULL, ",")) {
+		struct field field;
+		if (!golden->layout->get_field(golden->layout, name, &field))
+			return -1;
+
+		memset(golden->mask + field.desc->offset, 0,
+		       field.desc->data_size);
+	}
+
+	return 0;
+}
+
+/*
+ * field_at() - find the field of the layout which holds the byte at the given
+ * offset
+ */
+static const struct field_desc *field_at(struct layout *layout, int offset)
+{
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		const struct field_desc *field = &layout->fields[i];
+		if (offset >= field->offset &&
+		    offset < field->offset + field->data_size)
+			return field;
+	}
+
+	return NULL;
+}
+
+/*
+ * compare_device() - compare the device set up in api with the golden image
+ *
+ * Reading stops at the first mismatch, unless a full report was requested.
+ * In that case, the first mismatch in every field is reported.
+ *
+ * Returns: 0 if the device matches, -1 if not or on failure.
+ */
+static int compare_device(struct api *api, void *ctx)
+{
+	struct golden *golden = ctx;
+	int mismatches = 0, next = 0;
+
+	for (int i = 0; i < EEPROM_SIZE; i += READ_CHUNK) {
+		if (api->read(api, buf, i, READ_CHUNK) < 0) {
+			api->system_error("Read error");
+			return -1;
+		}
+
+		while (next < i + READ_CHUNK) {
+			int offset = find_mismatch(buf + next,
+						   golden->image + next,
+						   golden->mask + next,
+						   i + READ_CHUNK - next);
+			if (offset < 0) {
+				next = i + READ_CHUNK;
+				break;
+			}
+
+			offset += next;
+			const struct field_desc *field = field_at(golden->layout,
+								  offset);
+			printf("i2c-%d 0x%02x: mismatch at offset 0x%02x",
+			       api->i2c_bus, api->i2c_addr, offset);
+			if (field && field->type != FIELD_RAW)
+				printf(" (%s)", field->name);
+			printf(": expected 0x%02x, found 0x%02x\n",
+			       golden->image[offset], buf[offset]);
+
+			mismatches++;
+			if (!golden->cmd->opts->full_report)
+				return -1;
+
+			/* report each field once */
+			next = offset + 1;
+			if (field && field->type != FIELD_RAW)
+				next = field->offset + field->data_size;
+		}
+	}
+
+	if (mismatches)
+		return -1;
+
+	printf("i2c-%d 0x%02x: match\n", api->i2c_bus, api->i2c_addr);
+	return 0;
+}
+
+/*
+ * compare_eeproms() - compare each of the given devices, or each device found
+ * if none are given, with the golden image.
+ *
+ * Returns: 0 if all devices match, -1 otherwise.
+ */
+static int compare_eeproms(struct command *cmd)
+{
+	struct golden golden = { .cmd = cmd };
+	struct data_array *devices = cmd->data;
+	int ret = 0;
+
+	if (load_golden(&golden)) {
+		free_layout(golden.layout);
+		return -1;
+	}
+
+	if (devices->size == 0) {
+		ret = api.scan(&api, compare_device, &golden);
+	} else {
+		for (int i = 0; i < devices->size; i++) {
+			api.close(&api);
+			init_api(cmd, devices->devices[i].bus,
+				 devices->devices[i].addr);
+			if (compare_device(&api, &golden))
+				ret = -1;
+		}
+
+		api.close(&api);
+	}
+
+	free_layout(golden.layout);
+	return ret;
+}
+
+/*
+ * comment_prefix() - get the prefix which makes a line a comment in the given
+ * machine readable print format
+ *
+ * Returns: the prefix, or NULL if the format has no comments.
+ */
+static const char *comment_prefix(enum print_format print_format)
+{
+	switch (print_format) {
+	case FORMAT_DUMP:
+		return "; ";
+	case FORMAT_SHELL:
+	case FORMAT_UDEV:
+		return "# ";
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * poll_ranges() - read the next bytes of the given ranges into their offsets
+ * in dest, continuing from where the previous poll stopped.
+ * @ranges:	The ranges to poll, polled as if they were one buffer
+ * @num_ranges:	The number of ranges
+ * @cursor:	The position in the ranges of the next byte to poll. Updated,
+ *		and wraps around at the end of the ranges.
+ * @size:	The number of bytes to read
+ * @dest:	Where to save the bytes
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int poll_ranges(const struct bytes_range *ranges, int num_ranges,
+		       int *cursor, int size, unsigned char *dest)
+{
+	int total = 0;
+
+	for (int i = 0; i < num_ranges; i++)
+		total += ranges[i].end - ranges[i].start + 1;
+
+	if (size > total)
+		size = total;
+
+	while (size > 0) {
+		int i = 0, pos = *cursor;
+		while (pos > ranges[i].end - ranges[i].start) {
+			pos -= ranges[i].end - ranges[i].start + 1;
+			i++;
+		}
+
+		int len = ranges[i].end - ranges[i].start + 1 - pos;
+		if (len > size)
+			len = size;
+
+		if (api.read(&api, dest, ranges[i].start + pos, len) < 0)
+			return -1;
+
+		size -= len;
+		*cursor = (*cursor + len) % total;
+	}
+
+	return 0;
+}
+
+/*
+ * begin_json_device() - begin the JSON object of a device with its bus and
+ * address. The caller adds the other members, and ends the object.
+ */
+static void begin_json_device(int i2c_bus, int i2c_addr)
+{
+	json_begin_object();
+	json_key("i2c_bus");
+	json_uint(i2c_bus);
+	json_key("i2c_addr");
+	json_uint(i2c_addr);
+}
+
+/*
+ * print_json_changes() - print the fields which differ between two images as
+ * the "old" and "new" objects of the JSON object of the device
+ */
+static void print_json_changes(const struct layout *layout,
+			       unsigned char *old, unsigned char *new)
+{
+	unsigned char *images[] = { old, new };
+	const char *keys[] = { "old", "new" };
+
+	for (int i = 0; i < ARRAY_LEN(images); i++) {
+		json_key(keys[i]);
+		json_begin_object();
+		for (int j = 0; j < layout->num_of_fields; j++) {
+			struct field field = layout_field(layout, j);
+			int offset = field.desc->offset;
+
+			if (!memcmp(old + offset, new + offset,
+				    field.desc->data_size))
+				continue;
+
+			field.data = images[i] + offset;
+			field.ops->print(&field);
+		}
+		json_end_object();
+	}
+}
+
+/*
+ * print_changes() - print the fields which differ between two images of the
+ * watched device
+ * @event:	What happened to the device
+ */
+static int print_changes(struct command *cmd, const char *event,
+			 unsigned char *old, unsigned char *new)
+{
+	enum print_format print_format = cmd->opts->print_format;
+	struct layout *layout = new_layout(old, EEPROM_SIZE,
+					   cmd->opts->layout_ver, print_format);
+	if (!layout) {
+		api.system_error("Memory allocation error");
+		return -1;
+	}
+
+	enum layout_version old_version = layout->layout_version;
+	free_layout(layout);
+	layout = new_layout(new, EEPROM_SIZE, cmd->opts->layout_ver,
+			    print_format);
+	if (!layout) {
+		api.system_error("Memory allocation error");
+		return -1;
+	}
+
+	/* a record holds the entire image, so it's printed on every change */
+	if (print_format == FORMAT_BINARY) {
+		print_record(layout, api.i2c_bus, api.i2c_addr,
+			     cmd->opts->field_table);
+		free_layout(layout);
+		return 0;
+	}
+
+	bool json = print_format == FORMAT_JSON;
+	const char *comment = comment_prefix(print_format);
+	if (json) {
+		begin_json_device(api.i2c_bus, api.i2c_addr);
+		json_key("event");
+		json_string(event);
+	} else if (comment) {
+		printf("%si2c-%d 0x%02x: %s\n", comment, api.i2c_bus,
+		       api.i2c_addr, event);
+	} else {
+		printf(COLOR_GREEN "i2c-%d 0x%02x: %s\n" COLOR_RESET,
+		       api.i2c_bus, api.i2c_addr, event);
+	}
+
+	if (layout->layout_version != old_version) {
+		if (json)
+			json_key("fields");
+		layout->print(layout);
+		goto done;
+	}
+
+	if (json) {
+		print_json_changes(layout, old, new);
+		goto done;
+	}
+
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		struct field field = layout_field(layout, i);
+		int offset = field.desc->offset;
+
+		if (!memcmp(old + offset, new + offset, field.desc->data_size))
+			continue;
+
+		/* reserved fields are only printed in the default format */
+		if (field.desc->type == FIELD_RESERVED &&
+		    print_format != FORMAT_DEFAULT)
+			continue;
+
+		out_str("-");
+		field.data = old + offset;
+		field.ops->print(&field);
+		out_str("+");
+		field.data = new + offset;
+		field.ops->print(&field);
+	}
+
+done:
+	if (json)
+		json_end_object();
+
+	free_layout(layout);
+	out_flush();
+	return 0;
+}
+
+static int fingerprint_size(void)
+{
+	int size = 0;
+
+	for (int i = 0; i < num_fingerprint_ranges; i++)
+		size += fingerprint[i].end - fingerprint[i].start + 1;
+
+	return size;
+}
+
+/*
+ * watch_eeprom() - watch the device for changes until killed
+ *
+ * Every interval, read as much of the fingerprint as the budget allows,
+ * continuing where the previous poll stopped. The rest of the budget, if
+ * any, is spent on the rest of the image in the same way, so changes outside
+ * the fingerprint are eventually noticed too. The device is read entirely
+ * only if a polled byte changed, or the device comes back after a failed
+ * poll.
+ *
+ * Returns: -1 if the initial read fails. Doesn't return otherwise.
+ */
+static int watch_eeprom(struct command *cmd)
+{
+	static const struct bytes_range image_range = { 0, EEPROM_SIZE - 1 };
+	unsigned char image[EEPROM_SIZE], poll[EEPROM_SIZE];
+	int fingerprint_cursor = 0, image_cursor = 0;
+	int budget = cmd->opts->budget;
+	int fingerprint_budget = fingerprint_size();
+	bool present = true;
+
+	if (budget <= 0)
+		budget = fingerprint_budget;
+	if (fingerprint_budget > budget)
+		fingerprint_budget = budget;
+
+	if (read_eeprom(image) < 0)
+		return -1;
+
+	for (;;) {
+		sleep(cmd->opts->interval);
+
+		memcpy(poll, image, EEPROM_SIZE);
+		int ret = poll_ranges(fingerprint, num_fingerprint_ranges,
+				      &fingerprint_cursor, fingerprint_budget,
+				      poll);
+		if (!ret && budget > fingerprint_budget)
+			ret = poll_ranges(&image_range, 1, &image_cursor,
+					  budget - fingerprint_budget, poll);
+
+		if (!ret && present && !memcmp(poll, image, EEPROM_SIZE))
+			continue;
+
+		if (!ret)
+			ret = api.read(&api, buf, 0, EEPROM_SIZE);
+
+		if (ret < 0) {
+			if (present &&
+			    cmd->opts->print_format == FORMAT_JSON) {
+				begin_json_device(api.i2c_bus, api.i2c_addr);
+				json_key("event");
+				json_string("removed");
+				json_end_object();
+				out_flush();
+			} else if (present &&
+				   cmd->opts->print_format != FORMAT_BINARY) {
+				const char *comment =
+					comment_prefix(cmd->opts->print_format);
+				printf("%si2c-%d 0x%02x: removed\n",
+				       comment ? comment : "", api.i2c_bus,
+				       api.i2c_addr);
+				fflush(stdout);
+			}
+
+			present = false;
+			continue;
+		}
+
+		print_changes(cmd, present ? "changed" : "inserted", image,
+			      buf);
+		memcpy(image, buf, EEPROM_SIZE);
+		present = true;
+	}
+
+	return 0;
+}
+
+/*
+ * read_cached() - load the cached image of the device into buf, and check it
+ * against the fingerprint read from the device.
+ * @cmd:		The command, which holds the cache directory
+ * @layout_version:	Where to save the cached layout version
+ *
+ * Returns: true if buf holds a valid cached image, false otherwise.
+ */
+static bool read_cached(struct command *cmd, int *layout_version)
+{
+	unsigned char device[EEPROM_SIZE];
+
+	if (store_load(cmd->opts->store_dir, api.i2c_bus, api.i2c_addr, buf,
+		       NULL, layout_version) < 0)
+		return false;
+
+	return read_fingerprint(device) == 0 &&
+	       fingerprint_matches(device, buf);
+}
+
+/*
+ * update_cache() - replace the cached image of the device after a write
+ *
+ * Writes update the cache even without --cached if the device has a cached
+ * image, so later cached reads never see stale data.
+ */
+static void update_cache(struct command *cmd, const unsigned char *data)
 {
-	int ret = api.write(&api, data, 0, EEPROM_SIZE);
+	unsigned char old[EEPROM_SIZE];
 
-	if (ret < 0)
-		api.system_error("Write error");
+	if (!cmd->opts->cached &&
+	    store_load(cmd->opts->store_dir, api.i2c_bus, api.i2c_addr, old,
+		       NULL, NULL) < 0)
+		return;
 
-	return ret;
+	store_save(cmd->opts->store_dir, api.i2c_bus, api.i2c_addr, data,
+		   LAYOUT_AUTODETECT);
 }
 
 static struct layout *prepare_layout(struct command *cmd)
 {
-	if (read_eeprom(buf) < 0)
+	int cached_version = LAYOUT_AUTODETECT;
+	enum layout_version layout_ver = cmd->opts->layout_ver;
+	bool cached = cmd->opts->cached && read_cached(cmd, &cached_version);
+
+	if (!cached && read_eeprom(buf) < 0)
 		return NULL;
 
+	/* the cached layout version saves detecting it again */
+	if (cached && layout_ver == LAYOUT_AUTODETECT)
+		layout_ver = cached_version;
+
 	struct layout *layout = NULL;
-	layout = new_layout(buf, EEPROM_SIZE, cmd->opts->layout_ver,
+	layout = new_layout(buf, EEPROM_SIZE, layout_ver,
 			    cmd->opts->print_format);
 
-	if (!layout)
+	if (!layout) {
 		api.system_error("Memory allocation error");
+		return NULL;
+	}
+
+	if (cmd->opts->cached && (!cached || layout_ver == LAYOUT_AUTODETECT))
+		store_save(cmd->opts->store_dir, api.i2c_bus, api.i2c_addr,
+			   buf, cmd->opts->layout_ver == LAYOUT_AUTODETECT ?
+			   layout->layout_version : LAYOUT_AUTODETECT);
 
 	return layout;
 }
 
+/*
+ * image_hash() - get the 64 bit FNV-1a hash of an image, which identifies
+ * the image an update is based on for --if-match
+ */
+static uint64_t image_hash(const unsigned char *image)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		hash = (hash ^ image[i]) * 1099511628211ull;
+
+	return hash;
+}
+
+/*
+ * apply_action() - apply one read, write or clear action to the image in the
+ * layout
+ *
+ * Returns: true on success, false on failure.
+ */
+static bool apply_action(struct command *cmd, struct layout *layout,
+			 enum action action, struct data_array *data)
+{
+	switch (action) {
+	case EEPROM_READ:
+		if (cmd->opts->print_format == FORMAT_BINARY)
+			return print_record(layout, api.i2c_bus, api.i2c_addr,
+					    cmd->opts->field_table) == 0;
+
+		layout->print(layout);
+		return true;
+	case EEPROM_CLEAR:
+		memset(layout->data, 0xff, layout->data_size);
+		return true;
+	case EEPROM_WRITE_FIELDS:
+		return layout->update_fields(layout, data);
+	case EEPROM_WRITE_BYTES:
+		return layout->update_bytes(layout, data);
+	case EEPROM_CLEAR_FIELDS:
+		return layout->clear_fields(layout, data);
+	case EEPROM_CLEAR_BYTES:
+		return layout->clear_bytes(layout, data);
+	default:
+		return false;
+	}
+}
+
+/*
+ * modify_image() - apply the changes of a write command to the image
+ * @cmd:	The write, clear or script command
+ * @layout:	The layout of the image
+ *
+ * The commands of a script are applied in order, and the layout is rebuilt
+ * after every command, so the layout version is detected as if each command
+ * ran on its own.
+ *
+ * Returns: true on success, false on failure.
+ */
+static bool modify_image(struct command *cmd, struct layout **layout)
+{
+	if (cmd->action == EEPROM_MIGRATE)
+		return (*layout)->migrate(*layout, cmd->opts->target_layout) == 0;
+
+	if (cmd->action != EEPROM_SCRIPT)
+		return apply_action(cmd, *layout, cmd->action, cmd->data);
+
+	for (int i = 0; i < cmd->data->size; i++) {
+		struct script_step *step = &cmd->data->script_steps[i];
+		if (!apply_action(cmd, *layout, step->action, &step->data)) {
+			ieprintf("Script command %d failed. Nothing was written",
+				 i + 1);
+			return false;
+		}
+
+		free_layout(*layout);
+		*layout = new_layout(buf, EEPROM_SIZE, cmd->opts->layout_ver,
+				     cmd->opts->print_format);
+		if (!*layout) {
+			api.system_error("Memory allocation error");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * commit_image() - write the pages of data which differ from the snapshot
+ * the changes are based on, if the EEPROM still holds the snapshot there
+ * @cmd:	The write command
+ * @data:	The new image
+ * @snapshot:	The image which was read before applying the changes
+ *
+ * Only the pages about to be written are read again, right before writing
+ * them. Changes made by others to the rest of the EEPROM are kept.
+ *
+ * Returns: 0 on success, -EAGAIN if the pages changed, -1 on failure.
+ */
+static int commit_image(struct command *cmd, unsigned char *data,
+			const unsigned char *snapshot)
+{
+	unsigned char current[EEPROM_SIZE];
+	struct journal journal;
+	int size, ret;
+
+	if (!memcmp(data, snapshot, EEPROM_SIZE))
+		return 0;
+
+	for (int start = next_dirty_run(data, snapshot, 0, &size); start >= 0;
+	     start = next_dirty_run(data, snapshot, start + size, &size)) {
+		if (api.read(&api, current, start, size) < 0) {
+			api.system_error("Read error");
+			return -1;
+		}
+
+		if (memcmp(current + start, snapshot + start, size))
+			return -EAGAIN;
+	}
+
+	if (journal_begin(&journal, cmd->opts->journal_dir, api.i2c_bus,
+			  api.i2c_addr, snapshot, data) < 0)
+		return -1;
+
+	memcpy(current, snapshot, EEPROM_SIZE);
+	ret = write_pending(&journal, data, current);
+	journal_close(&journal);
+	if (ret < 0)
+		return -1;
+
+	update_cache(cmd, data);
+	return 0;
+}
+
+/*
+ * resume_journal() - finish the last write to the device, if it was
+ * interrupted
+ *
+ * Returns: 1 if a write was finished, 0 if there was nothing to finish, -1 on
+ * failure.
+ */
+static int resume_journal(struct command *cmd)
+{
+	struct journal journal;
+	int ret = -1;
+
+	if (journal_load(&journal, cmd->opts->journal_dir, api.i2c_bus,
+			 api.i2c_addr) < 0)
+		return 0;
+
+	if (!journal.header.pending) {
+		journal_close(&journal);
+		return 0;
+	}
+
+	printf("Finishing an interrupted write to i2c-%d, address 0x%02x\n",
+	       api.i2c_bus, api.i2c_addr);
+	if (read_eeprom(buf) < 0 ||
+	    write_pending(&journal, journal.new_image, buf) < 0)
+		goto done;
+
+	update_cache(cmd, buf);
+	ret = 1;
+
+done:
+	journal_close(&journal);
+	return ret;
+}
+
+/*
+ * undo_write() - restore the bytes changed by the last write to the device
+ *
+ * The pages touched by the last write are restored to their contents before
+ * it, if the write was interrupted, or if they weren't changed since. The
+ * restore is itself journaled, so undoing it redoes the write.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int undo_write(struct command *cmd)
+{
+	struct journal journal;
+	unsigned char image[EEPROM_SIZE];
+	int size, ret = -1;
+
+	if (journal_load(&journal, cmd->opts->journal_dir, api.i2c_bus,
+			 api.i2c_addr) < 0) {
+		ieprintf("No write to undo");
+		return -1;
+	}
+
+	bool interrupted = journal.header.pending;
+	journal_close(&journal);
+	if (read_eeprom(buf) < 0)
+		return -1;
+
+	memcpy(image, buf, EEPROM_SIZE);
+	for (int start = next_dirty_run(journal.new_image, journal.old_image, 0,
+					&size);
+	     start >= 0;
+	     start = next_dirty_run(journal.new_image, journal.old_image,
+				    start + size, &size)) {
+		if (!interrupted &&
+		    memcmp(buf + start, journal.new_image + start, size)) {
+			ieprintf("EEPROM changed since the last write. Nothing was written");
+			return -1;
+		}
+
+		memcpy(image + start, journal.old_image + start, size);
+	}
+
+	if (journal_begin(&journal, cmd->opts->journal_dir, api.i2c_bus,
+			  api.i2c_addr, buf, image) < 0)
+		return -1;
+
+	if (write_pending(&journal, image, buf) == 0) {
+		update_cache(cmd, buf);
+		ret = 0;
+	}
+
+	journal_close(&journal);
+	return ret;
+}
+
+/*
+ * update_eeprom() - read the EEPROM, apply the changes of a write command to
+ * its image, and commit them
+ *
+ * If the pages about to be written changed since they were read, another
+ * writer got in the way. The changes are then applied again to a new image,
+ * unless the update is pinned to an image with --if-match, or it is a script
+ * which already printed parts of the old image.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int update_eeprom(struct command *cmd)
+{
+	unsigned char snapshot[EEPROM_SIZE];
+
+	if (resume_journal(cmd) < 0)
+		return -1;
+
+	for (int attempt = 0; ; attempt++) {
+		struct layout *layout = prepare_layout(cmd);
+		if (!layout)
+			return -1;
+
+		memcpy(snapshot, buf, EEPROM_SIZE);
+		if (cmd->opts->if_match &&
+		    image_hash(snapshot) != cmd->opts->match_hash) {
+			ieprintf("EEPROM does not match the given hash. Nothing was written");
+			free_layout(layout);
+			return -1;
+		}
+
+		int ret = modify_image(cmd, &layout) ?
+			  commit_image(cmd, buf, snapshot) : -1;
+		free_layout(layout);
+		if (ret != -EAGAIN)
+			return ret;
+
+		if (cmd->opts->if_match || cmd->action == EEPROM_SCRIPT ||
+		    attempt == CONFLICT_RETRIES) {
+			ieprintf("EEPROM changed while updating. Nothing was written");
+			return -1;
+		}
+
+		/* the cached image is stale, even if the fingerprint isn't */
+		cmd->opts->cached = false;
+	}
+}
+
+/*
+ * migrate_dry_run() - print the bytes which migrating the EEPROM would change,
+ * along with the fields of the target layout which hold them
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int migrate_dry_run(struct command *cmd)
+{
+	unsigned char old[EEPROM_SIZE];
+	int size, bytes = 0, pages = 0;
+
+	struct layout *layout = prepare_layout(cmd);
+	if (!layout)
+		return -1;
+
+	memcpy(old, buf, EEPROM_SIZE);
+	int ret = layout->migrate(layout, cmd->opts->target_layout);
+	free_layout(layout);
+	if (ret < 0)
+		return -1;
+
+	layout = new_layout(buf, EEPROM_SIZE, cmd->opts->target_layout,
+			    FORMAT_DEFAULT);
+	if (!layout) {
+		api.system_error("Memory allocation error");
+		return -1;
+	}
+
+	for (int i = 0; i < EEPROM_SIZE; i++) {
+		if (old[i] == buf[i])
+			continue;
+
+		printf("0x%02x	0x%02x -> 0x%02x	%s\n", i, old[i], buf[i],
+		       field_at(layout, i)->name);
+		bytes++;
+	}
+
+	for (int start = next_dirty_run(buf, old, 0, &size); start >= 0;
+	     start = next_dirty_run(buf, old, start + size, &size))
+		pages += size / EEPROM_PAGE_SIZE;
+
+	printf("%d bytes in %d pages would be written\n", bytes, pages);
+	free_layout(layout);
+	return 0;
+}
+
+/*
+ * print_layout_of() - print a layout, prefixed by the bus and address of the
+ * device it was read from. In the binary format, print the record of the
+ * device instead.
+ *
+ * Returns: 0 on success, -1 on failure or if a checksum is invalid.
+ */
+static int print_layout_of(struct command *cmd, const struct layout *layout,
+			   int i2c_bus, int i2c_addr)
+{
+	if (cmd->opts->print_format == FORMAT_BINARY) {
+		if (print_record(layout, i2c_bus, i2c_addr,
+				 cmd->opts->field_table) < 0)
+			return -1;
+
+		return layout->check_crcs(layout) ? 0 : -1;
+	}
+
+	/* keep machine readable output usable as input by using a comment */
+	bool json = cmd->opts->print_format == FORMAT_JSON;
+	const char *comment = comment_prefix(cmd->opts->print_format);
+	if (json) {
+		begin_json_device(i2c_bus, i2c_addr);
+		json_key("fields");
+	} else if (comment) {
+		printf("%sOn i2c-%d, address 0x%02x:\n", comment, i2c_bus,
+		       i2c_addr);
+	} else {
+		printf(COLOR_GREEN "On i2c-%d, address 0x%02x:\n" COLOR_RESET,
+		       i2c_bus, i2c_addr);
+	}
+
+	layout->print(layout);
+	if (json) {
+		json_end_object();
+		out_flush();
+	} else {
+		printf("\n");
+	}
+
+	return layout->check_crcs(layout) ? 0 : -1;
+}
+
+/*
+ * print_device() - print the layout of the image in buf, prefixed by the bus
+ * and address of the device it was read from.
+ *
+ * Returns: 0 on success, -1 on failure or if a checksum is invalid.
+ */
+static int print_device(struct command *cmd, struct api *api)
+{
+	struct layout *layout = new_layout(buf, EEPROM_SIZE,
+					   cmd->opts->layout_ver,
+					   cmd->opts->print_format);
+	if (!layout) {
+		api->system_error("Memory allocation error");
+		return -1;
+	}
+
+	int ret = print_layout_of(cmd, layout, api->i2c_bus, api->i2c_addr);
+	free_layout(layout);
+
+	return ret;
+}
+
+/*
+ * print_records() - print the devices of the records read from standard
+ * input, which were printed in the binary format.
+ *
+ * The layout version of each record is used, unless one was given with -l.
+ *
+ * Returns: 0 on success, -1 on failure or if a checksum is invalid.
+ */
+static int print_records(struct command *cmd)
+{
+	struct record_header header;
+	unsigned char image[EEPROM_SIZE];
+	int ret = 0, read;
+
+	while ((read = read_record(stdin, &header, image)) > 0) {
+		enum layout_version layout_version = cmd->opts->layout_ver;
+		if (layout_version == LAYOUT_AUTODETECT)
+			layout_version = header.layout_version;
+
+		struct layout *layout = new_layout(image, EEPROM_SIZE,
+						   layout_version,
+						   cmd->opts->print_format);
+		if (!layout) {
+			perror(STR_ENO_MEM);
+			return -1;
+		}
+
+		if (print_layout_of(cmd, layout, header.i2c_bus,
+				    header.i2c_addr) < 0)
+			ret = -1;
+
+		free_layout(layout);
+	}
+
+	return read < 0 ? -1 : ret;
+}
+
+/*
+ * print_found_eeprom() - api->scan() callback which reads a found device and
+ * prints its layout.
+ */
+static int print_found_eeprom(struct api *api, void *ctx)
+{
+	if (read_eeprom(buf) < 0)
+		return -1;
+
+	return print_device(ctx, api);
+}
+
+/*
+ * rescan_found_eeprom() - api->scan() callback which prints a found device
+ * using its image from the previous scan if possible.
+ *
+ * The stored image is used if its fingerprint matches the device and it isn't
+ * older than the maximum age. Otherwise, the entire device is read and its
+ * image is stored for the next scan.
+ */
+static int rescan_found_eeprom(struct api *api, void *ctx)
+{
+	struct command *cmd = ctx;
+	unsigned char device[EEPROM_SIZE];
+	time_t mtime;
+
+	if (store_load(cmd->opts->store_dir, api->i2c_bus, api->i2c_addr,
+		       buf, &mtime, NULL) == 0 &&
+	    time(NULL) - mtime <= cmd->opts->max_age) {
+		if (read_fingerprint(device) < 0)
+			return -1;
+
+		if (fingerprint_matches(device, buf))
+			return print_device(cmd, api);
+	}
+
+	if (read_eeprom(buf) < 0)
+		return -1;
+
+	/* a failure to store only costs a full read on the next scan */
+	store_save(cmd->opts->store_dir, api->i2c_bus, api->i2c_addr, buf,
+		   LAYOUT_AUTODETECT);
+
+	return print_device(cmd, api);
+}
+
 static int execute_command(struct command *cmd)
 {
 	ASSERT(cmd && cmd->action != EEPROM_ACTION_INVALID);
@@ -71,56 +1292,126 @@ static int execute_command(struct command *cmd)
 	int ret = -1;
 	struct layout *layout = NULL;
 
-	api_init(&api, cmd->opts->i2c_bus, cmd->opts->i2c_addr);
+	switch (cmd->action) {
+	case EEPROM_INVENTORY_ADD:
+		return inventory_add(cmd->opts->store_dir, cmd->data);
+	case EEPROM_INVENTORY_FIND:
+		return inventory_find(cmd->opts->store_dir, cmd->data);
+	case EEPROM_INVENTORY_DUPS:
+		return inventory_dups(cmd->opts->store_dir);
+	case EEPROM_DAEMON:
+		return run_daemon(cmd->opts->socket_path);
+	default:
+		break;
+	}
+
+	if (load_custom_layouts(cmd->opts->layouts_dir, DEFAULT_CACHE_DIR) < 0)
+		return -1;
+
+	if (cmd->opts->print_prefix)
+		set_print_prefix(cmd->opts->print_prefix);
+
+	set_mac_array(cmd->opts->mac_array);
+
+	if (cmd->action == EEPROM_RECORDS)
+		return print_records(cmd);
+
+	init_api(cmd, cmd->opts->i2c_bus, cmd->opts->i2c_addr);
 
 	if (cmd->action == EEPROM_LIST)
 		return api.probe(&api);
 
-	if (cmd->action == EEPROM_CLEAR) {
-		memset(buf, 0xff, EEPROM_SIZE);
-		return write_eeprom(buf);
+	if (cmd->action == EEPROM_READ_ALL)
+		return api.scan(&api, print_found_eeprom, cmd);
+
+	if (cmd->action == EEPROM_RESCAN)
+		return api.scan(&api, rescan_found_eeprom, cmd);
+
+	if (cmd->action == EEPROM_MIGRATE && cmd->opts->dry_run)
+		return migrate_dry_run(cmd);
+
+	if (cmd->action == EEPROM_CLEAR || cmd->action == EEPROM_SCRIPT ||
+	    cmd->action == EEPROM_MIGRATE ||
+	    cmd->action == EEPROM_WRITE_FIELDS ||
+	    cmd->action == EEPROM_WRITE_BYTES ||
+	    cmd->action == EEPROM_CLEAR_FIELDS ||
+	    cmd->action == EEPROM_CLEAR_BYTES)
+		return update_eeprom(cmd);
+
+	if (cmd->action == EEPROM_RESUME) {
+		ret = resume_journal(cmd);
+		if (ret == 0)
+			printf("No interrupted write to resume\n");
+
+		return ret < 0 ? -1 : 0;
+	}
+
+	if (cmd->action == EEPROM_UNDO)
+		return undo_write(cmd);
+
+	if (cmd->action == EEPROM_COUNTER) {
+		unsigned int value;
+
+		ret = counter_read(&api, cmd->opts->counter_span,
+				   cmd->opts->layout_ver, &value);
+		if (ret == 0)
+			printf("%u\n", value);
+
+		return ret;
+	}
+
+	if (cmd->action == EEPROM_COUNTER_INC) {
+		unsigned int value;
+
+		/* a pending write could later overwrite the slot with old data */
+		if (resume_journal(cmd) < 0)
+			return -1;
+
+		ret = counter_increment(&api, cmd->opts->counter_span,
+					cmd->opts->layout_ver, buf, &value);
+		if (ret < 0)
+			return ret;
+
+		update_cache(cmd, buf);
+		printf("%u\n", value);
+		return 0;
 	}
 
+	if (cmd->action == EEPROM_BLANK_CHECK)
+		return blank_check();
+
+	if (cmd->action == EEPROM_COMPARE)
+		return compare_eeproms(cmd);
+
+	if (cmd->action == EEPROM_WATCH)
+		return watch_eeprom(cmd);
+
 	layout = prepare_layout(cmd);
 	if (!layout)
 		return -1;
 
 	switch(cmd->action) {
 	case EEPROM_READ:
-		layout->print(layout);
-		ret = 0;
-		goto done;
-	case EEPROM_WRITE_FIELDS:
-		if (!layout->update_fields(layout, cmd->data)) {
-			ret = -1;
-			goto done;
-		}
-		break;
-	case EEPROM_WRITE_BYTES:
-		if (!layout->update_bytes(layout, cmd->data)) {
-			ret = -1;
-			goto done;
+		if (cmd->opts->print_format == FORMAT_BINARY) {
+			ret = print_layout_of(cmd, layout, api.i2c_bus,
+					      api.i2c_addr);
+			break;
 		}
+
+		layout->print(layout);
+		ret = layout->check_crcs(layout) ? 0 : -1;
 		break;
-	case EEPROM_CLEAR_FIELDS:
-		if (!layout->clear_fields(layout, cmd->data)) {
-			ret = -1;
-			goto done;
-		}
+	case EEPROM_HASH:
+		printf("%016" PRIx64 "\n", image_hash(layout->data));
+		ret = 0;
 		break;
-	case EEPROM_CLEAR_BYTES:
-		if (!layout->clear_bytes(layout, cmd->data)) {
-			ret = -1;
-			goto done;
-		}
+	case EEPROM_EXPORT_SHM:
+		ret = export_shm(layout, api.i2c_bus, api.i2c_addr);
 		break;
 	default:
-		goto done;
+		break;
 	}
 
-	ret = write_eeprom(layout->data);
-
-done:
 	free_layout(layout);
 	return ret;
 }
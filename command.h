@@ -20,17 +20,41 @@
 #ifndef _COMMAND_
 #define _COMMAND_
 
+#include <stdint.h>
 #include "common.h"
 #include "layout.h"
 
+#define DEFAULT_WATCH_INTERVAL	10
+
+/* The number of times an update is applied again after a conflicting write */
+#define CONFLICT_RETRIES	3
+
 enum action {
 	EEPROM_READ,
+	EEPROM_READ_ALL,
+	EEPROM_RESCAN,
+	EEPROM_INVENTORY_ADD,
+	EEPROM_INVENTORY_FIND,
+	EEPROM_INVENTORY_DUPS,
 	EEPROM_WRITE_FIELDS,
 	EEPROM_WRITE_BYTES,
 	EEPROM_LIST,
 	EEPROM_CLEAR,
 	EEPROM_CLEAR_FIELDS,
 	EEPROM_CLEAR_BYTES,
+	EEPROM_BLANK_CHECK,
+	EEPROM_EXPORT_SHM,
+	EEPROM_WATCH,
+	EEPROM_SCRIPT,
+	EEPROM_HASH,
+	EEPROM_RESUME,
+	EEPROM_UNDO,
+	EEPROM_COUNTER,
+	EEPROM_COUNTER_INC,
+	EEPROM_MIGRATE,
+	EEPROM_COMPARE,
+	EEPROM_DAEMON,
+	EEPROM_RECORDS,
 	EEPROM_ACTION_INVALID,
 };
 
@@ -39,6 +63,31 @@ struct options {
 	int i2c_addr;
 	enum layout_version layout_ver;
 	enum print_format print_format;
+	char *store_dir;
+	int max_age;
+	char *golden_file;
+	char *ignore_fields;
+	bool full_report;
+	char *socket_path;
+	bool cached;
+	int interval;
+	int budget;
+	char *print_prefix;
+	bool if_match;
+	uint64_t match_hash;
+	char *journal_dir;
+	char *layouts_dir;
+	struct bytes_range counter_span;
+	enum layout_version target_layout;
+	bool dry_run;
+	bool mac_array;
+	bool field_table;
+};
+
+/* One command of a script, with its parsed data */
+struct script_step {
+	enum action action;
+	struct data_array data;
 };
 
 struct command {
@@ -30,8 +30,13 @@
 #define MIN_I2C_ADDR 0x03
 #define MAX_I2C_ADDR 0x77
 
+#define MIN_EEPROM_ADDR 0x50
+#define MAX_EEPROM_ADDR 0x57
+
 #define STR_ENO_MEM "Out of memory"
 
+#define ARRAY_LEN(x) (sizeof(x) / sizeof((x)[0]))
+
 // Macro for printing error messages
 #define eprintf(args...) fprintf (stderr, args)
 // Macro for printing input error messages
@@ -63,6 +68,11 @@ struct bytes_range {
 	int end;
 };
 
+struct i2c_device {
+	int bus;
+	int addr;
+};
+
 struct data_array {
 	int size;
 	union {
@@ -70,6 +80,8 @@ struct data_array {
 		struct bytes_change *bytes_changes;
 		char **fields_list;
 		struct bytes_range *bytes_list;
+		struct i2c_device *devices;
+		struct script_step *script_steps;
 	};
 };
 
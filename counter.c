@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "layout.h"
+#include "counter.h"
+#include "api.h"
+
+/*
+ * A slot holds, in little endian:
+ *	bytes 0-3	the counter value
+ *	bytes 4-5	the sequence number of the slot
+ *	byte 6		zero
+ *	byte 7		CRC-8 of bytes 0-6
+ * The CRC is written last, so a slot torn by a power loss is ignored and the
+ * previous slot is used instead. Blank slots are invalid as well.
+ */
+struct slot {
+	unsigned int value;
+	unsigned short sequence;
+};
+
+static unsigned char crc8(const unsigned char *data, int size)
+{
+	unsigned char crc = 0;
+
+	for (int i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++)
+			crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+
+	return crc;
+}
+
+static bool decode_slot(const unsigned char *raw, struct slot *slot)
+{
+	if (raw[6] || crc8(raw, COUNTER_SLOT_SIZE - 1) != raw[7])
+		return false;
+
+	slot->value = raw[0] | raw[1] << 8 | raw[2] << 16 |
+		      (unsigned int)raw[3] << 24;
+	slot->sequence = raw[4] | raw[5] << 8;
+	return true;
+}
+
+static void encode_slot(unsigned char *raw, const struct slot *slot)
+{
+	for (int i = 0; i < 4; i++)
+		raw[i] = slot->value >> (8 * i);
+
+	raw[4] = slot->sequence;
+	raw[5] = slot->sequence >> 8;
+	raw[6] = 0;
+	raw[7] = crc8(raw, COUNTER_SLOT_SIZE - 1);
+}
+
+/*
+ * find_head() - find the slot written last
+ *
+ * Slots are written in turn with consecutive sequence numbers, so the last
+ * one is a valid slot which isn't followed by its successor. If corruption
+ * left more than one such slot, the one with the newest sequence wins.
+ *
+ * Returns: the index of the slot, or -1 if no slot is valid.
+ */
+static int find_head(const unsigned char *raw, int num_slots,
+		     struct slot *head)
+{
+	struct slot slot, next;
+	int found = -1;
+
+	for (int i = 0; i < num_slots; i++) {
+		if (!decode_slot(raw + i * COUNTER_SLOT_SIZE, &slot))
+			continue;
+
+		int n = (i + 1) % num_slots;
+		if (n != i && decode_slot(raw + n * COUNTER_SLOT_SIZE, &next) &&
+		    next.sequence == (unsigned short)(slot.sequence + 1))
+			continue;
+
+		if (found < 0 || (short)(slot.sequence - head->sequence) > 0) {
+			*head = slot;
+			found = i;
+		}
+	}
+
+	return found;
+}
+
+/*
+ * load_image() - read the EEPROM and check the span of the counter
+ *
+ * The layout of the EEPROM is detected from the image. The span must only
+ * cover reserved fields, none of which is covered by a checksum, so the
+ * counter can't clobber fields or invalidate checksums.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int load_image(struct api *api, struct bytes_range span,
+		      enum layout_version layout_version, unsigned char *raw)
+{
+	if (api->read(api, raw, 0, EEPROM_SIZE) < 0) {
+		api->system_error("Read error");
+		return -1;
+	}
+
+	struct layout *layout = new_layout(raw, EEPROM_SIZE, layout_version,
+					   FORMAT_DEFAULT);
+	if (!layout) {
+		api->system_error("Memory allocation error");
+		return -1;
+	}
+
+	bool reserved = true;
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		const struct field_desc *desc = &layout->fields[i];
+		int end = desc->offset + desc->data_size - 1;
+
+		if (desc->type != FIELD_RESERVED && desc->offset <= span.end &&
+		    end >= span.start)
+			reserved = false;
+
+		if (desc->type == FIELD_CRC && desc->span_start <= span.end &&
+		    desc->span_end >= span.start)
+			reserved = false;
+	}
+
+	free_layout(layout);
+	if (!reserved) {
+		ieprintf("Counter span %d-%d covers fields which aren't reserved, "
+			 "or bytes covered by a checksum", span.start, span.end);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * counter_read() - read the value of the counter kept in a span
+ * @api:	The device
+ * @span:	The span of the counter. Must hold whole slots.
+ * @layout_version:	The layout version of the EEPROM, or LAYOUT_AUTODETECT
+ * @value:	Where to save the value. 0 if the counter was never written.
+ *
+ * The EEPROM is read with a single read.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int counter_read(struct api *api, struct bytes_range span,
+		 enum layout_version layout_version, unsigned int *value)
+{
+	ASSERT(api && value);
+
+	unsigned char raw[EEPROM_SIZE];
+	struct slot head;
+
+	if (load_image(api, span, layout_version, raw) < 0)
+		return -1;
+
+	int num_slots = (span.end - span.start + 1) / COUNTER_SLOT_SIZE;
+	*value = find_head(raw + span.start, num_slots, &head) < 0 ?
+		 0 : head.value;
+
+	return 0;
+}
+
+/*
+ * counter_increment() - increment the counter kept in a span
+ * @api:	The device
+ * @span:	The span of the counter. Must hold whole slots.
+ * @layout_version:	The layout version of the EEPROM, or LAYOUT_AUTODETECT
+ * @raw:	Where to save the image of the EEPROM after the increment.
+ *		EEPROM_SIZE bytes.
+ * @value:	Where to save the new value
+ *
+ * The EEPROM is read with a single read, and only the slot after the last
+ * written one is written.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int counter_increment(struct api *api, struct bytes_range span,
+		      enum layout_version layout_version, unsigned char *raw,
+		      unsigned int *value)
+{
+	ASSERT(api && raw && value);
+
+	struct slot head = { 0, 0xffff };
+
+	if (load_image(api, span, layout_version, raw) < 0)
+		return -1;
+
+	int num_slots = (span.end - span.start + 1) / COUNTER_SLOT_SIZE;
+	int next = (find_head(raw + span.start, num_slots, &head) + 1) %
+		   num_slots;
+	int offset = span.start + next * COUNTER_SLOT_SIZE;
+
+	head.value++;
+	head.sequence++;
+	encode_slot(raw + offset, &head);
+	if (api->write(api, raw, offset, COUNTER_SLOT_SIZE) < 0) {
+		api->system_error("Write error");
+		return -1;
+	}
+
+	*value = head.value;
+	return 0;
+}
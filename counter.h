@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _COUNTER_
+#define _COUNTER_
+
+#include "common.h"
+#include "layout.h"
+
+struct api;
+
+/*
+ * The counter is kept in a span of reserved bytes, which is divided into
+ * slots. Each increment writes the next slot in turn, with the next sequence
+ * number, so every slot is written once every <number of slots> increments.
+ * The span must only cover reserved fields of the layout of the EEPROM. The
+ * default span is reserved in all the built-in layouts.
+ */
+#define COUNTER_SLOT_SIZE		8
+#define DEFAULT_COUNTER_START		80
+#define DEFAULT_COUNTER_END		127
+
+int counter_read(struct api *api, struct bytes_range span,
+		 enum layout_version layout_version, unsigned int *value);
+int counter_increment(struct api *api, struct bytes_range span,
+		      enum layout_version layout_version, unsigned char *raw,
+		      unsigned int *value);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "crc.h"
+
+#define CRC32C_POLY	0x82f63b78	/* Castagnoli, reflected */
+
+/* table[k][b] is the CRC of byte b followed by k zero bytes */
+static uint32_t table[8][256];
+
+static void __attribute__((constructor)) build_crc_table(void)
+{
+	for (int b = 0; b < 256; b++) {
+		uint32_t crc = b;
+		for (int i = 0; i < 8; i++)
+			crc = crc & 1 ? crc >> 1 ^ CRC32C_POLY : crc >> 1;
+
+		table[0][b] = crc;
+	}
+
+	for (int b = 0; b < 256; b++)
+		for (int k = 1; k < 8; k++)
+			table[k][b] = table[k - 1][b] >> 8 ^
+				      table[0][table[k - 1][b] & 0xff];
+}
+
+/* slice-by-8: 8 table lookups for every 8 bytes */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *data, size_t size)
+{
+	uint32_t lo, hi;
+
+	for (; size >= 8; size -= 8, data += 8) {
+		lo = crc ^ (data[0] | data[1] << 8 | data[2] << 16 |
+			    (uint32_t)data[3] << 24);
+		hi = data[4] | data[5] << 8 | data[6] << 16 |
+		     (uint32_t)data[7] << 24;
+		crc = table[7][lo & 0xff] ^ table[6][lo >> 8 & 0xff] ^
+		      table[5][lo >> 16 & 0xff] ^ table[4][lo >> 24] ^
+		      table[3][hi & 0xff] ^ table[2][hi >> 8 & 0xff] ^
+		      table[1][hi >> 16 & 0xff] ^ table[0][hi >> 24];
+	}
+
+	while (size--)
+		crc = crc >> 8 ^ table[0][(crc ^ *data++) & 0xff];
+
+	return crc;
+}
+
+#ifdef __x86_64__
+/* the crc32 instruction of SSE4.2 computes CRC32C */
+static uint32_t __attribute__((target("sse4.2")))
+crc32c_sse42(uint32_t crc, const unsigned char *data, size_t size)
+{
+	uint64_t crc64 = crc, word;
+
+	for (; size >= 8; size -= 8, data += 8) {
+		memcpy(&word, data, 8);
+		crc64 = __builtin_ia32_crc32di(crc64, word);
+	}
+
+	crc = crc64;
+	while (size--)
+		crc = __builtin_ia32_crc32qi(crc, *data++);
+
+	return crc;
+}
+#endif
+
+/*
+ * crc32c() - compute the CRC32C (Castagnoli) of data, with the SSE4.2 crc32
+ * instruction if the CPU has it, and with slice-by-8 tables otherwise.
+ */
+uint32_t crc32c(const unsigned char *data, size_t size)
+{
+#ifdef __x86_64__
+	static int has_sse42 = -1;
+
+	if (has_sse42 < 0)
+		has_sse42 = __builtin_cpu_supports("sse4.2");
+
+	if (has_sse42)
+		return ~crc32c_sse42(~0u, data, size);
+#endif
+
+	return ~crc32c_sw(~0u, data, size);
+}
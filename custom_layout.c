@@ -0,0 +1,609 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "layout.h"
+#include "store.h"
+#include "custom_layout.h"
+
+/*
+ * Custom layouts are described by text files in the layouts directory, one
+ * layout per file. They are compiled into a cache file, which holds the field
+ * descriptors and name indexes exactly as they are used, so later runs only
+ * map it. The cache is compiled again whenever the directory or any of the
+ * files it was compiled from changed.
+ *
+ * The cache consists of a struct cache_header, followed by num_layouts
+ * struct cache_layout, followed by the field descriptors of every layout.
+ */
+#define CACHE_MAGIC	"EEPL"
+#define CACHE_FORMAT	2
+
+struct cache_header {
+	char magic[4];
+	unsigned int format;
+	unsigned int desc_size;		/* sizeof(struct field_desc) */
+	unsigned int size;		/* of the entire cache */
+	unsigned int num_layouts;
+	struct timespec dir_mtime;
+	char dir[PATH_MAX];
+};
+
+struct cache_layout {
+	char file[NAME_MAX + 1];
+	struct timespec mtime;
+	off_t file_size;
+	int layout_version;
+	int num_of_fields;
+	unsigned int fields_offset;
+	struct name_index names;
+};
+
+struct field_type_name {
+	const char *name;
+	enum field_type type;
+	int size;			/* 0 if any size is valid */
+};
+
+static const struct field_type_name field_types[] = {
+	{ "binary",	FIELD_BINARY,	0 },
+	{ "reversed",	FIELD_REVERSED,	0 },
+	{ "version",	FIELD_VERSION,	2 },
+	{ "ascii",	FIELD_ASCII,	0 },
+	{ "mac",	FIELD_MAC,	6 },
+	{ "date",	FIELD_DATE,	4 },
+	{ "reserved",	FIELD_RESERVED,	0 },
+	{ "crc32c",	FIELD_CRC,	4 },	/* crc32c:<start>-<end> */
+};
+
+/* The cache in use. It stays mapped, or allocated, until the program exits */
+static const unsigned char *cache;
+
+static bool same_time(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+/*
+ * Short names are printed unquoted as shell variable and udev property names,
+ * so they must be valid as such.
+ */
+static bool valid_short_name(const char *name)
+{
+	if (!isalpha((unsigned char)*name) && *name != '_')
+		return false;
+
+	for (; *name; name++)
+		if (!isalnum((unsigned char)*name) && *name != '_')
+			return false;
+
+	return true;
+}
+
+/*
+ * parse_span() - parse the span of a checksum: <start>-<end>
+ *
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *parse_span(char *str, struct field_desc *field)
+{
+	if (!str || strtoi(&str, &field->span_start) != STRTOI_STR_CON ||
+	    *str++ != '-' || strtoi(&str, &field->span_end) != STRTOI_STR_END ||
+	    field->span_start < 0 || field->span_end >= EEPROM_SIZE ||
+	    field->span_end < field->span_start)
+		return "Expected crc32c:<start>-<end> within the EEPROM";
+
+	return NULL;
+}
+
+/*
+ * parse_field() - parse a field line: <short_name> <size> <type> <name>
+ *
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *parse_field(char *line, struct field_desc *field)
+{
+	char *short_name = strtok(line, " \t");
+	char *size = strtok(NULL, " \t");
+	char *type = strtok(NULL, " \t");
+	char *name = strtok(NULL, "");
+
+	if (!name)
+		return "Expected <short_name> <size> <type> <name>";
+
+	while (*name == ' ' || *name == '\t')
+		name++;
+
+	if (strlen(short_name) >= FIELD_SHORT_NAME_SIZE ||
+	    strlen(name) >= FIELD_NAME_SIZE)
+		return "Field name too long";
+
+	if (!valid_short_name(short_name))
+		return "Short names may only hold letters, digits and '_', "
+		       "and not begin with a digit";
+
+	strcpy(field->short_name, short_name);
+	strcpy(field->name, name);
+	if (strtoi(&size, &field->data_size) != STRTOI_STR_END ||
+	    field->data_size <= 0 || field->data_size > EEPROM_SIZE)
+		return "Invalid field size";
+
+	/* the type of a checksum is followed by its span */
+	char *span = strchr(type, ':');
+	if (span)
+		*span++ = '\0';
+
+	for (int i = 0; i < ARRAY_LEN(field_types); i++) {
+		if (strcmp(type, field_types[i].name))
+			continue;
+
+		if (field_types[i].size &&
+		    field_types[i].size != field->data_size)
+			return "Invalid size for the field type";
+
+		field->type = field_types[i].type;
+		if (field->type == FIELD_CRC)
+			return parse_span(span, field);
+
+		return span ? "Unknown field type" : NULL;
+	}
+
+	return "Unknown field type";
+}
+
+/*
+ * check_layout() - check that a parsed layout covers the EEPROM and can be
+ * detected by its Layout Version field
+ *
+ * Returns: NULL on success, or a description of the error.
+ */
+static const char *check_layout(const struct cache_layout *layout,
+				const struct field_desc *fields)
+{
+	if (layout->layout_version < 0)
+		return "Missing layout version";
+
+	if (!layout->num_of_fields)
+		return "Missing fields";
+
+	const struct field_desc *last = &fields[layout->num_of_fields - 1];
+	if (last->offset + last->data_size != EEPROM_SIZE)
+		return "The field sizes must add up to the EEPROM size";
+
+	/*
+	 * Checksums are computed in field order, so a checksum covering any
+	 * checksum, itself included, would be computed over a stale value.
+	 */
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		if (fields[i].type != FIELD_CRC)
+			continue;
+
+		for (int j = 0; j < layout->num_of_fields; j++)
+			if (fields[j].type == FIELD_CRC &&
+			    fields[i].span_start < fields[j].offset +
+						   fields[j].data_size &&
+			    fields[i].span_end >= fields[j].offset)
+				return "A checksum can't cover a checksum";
+	}
+
+	for (int i = 0; i < layout->num_of_fields; i++)
+		if (!strcmp(fields[i].short_name, "layout") &&
+		    fields[i].offset == LAYOUT_CHECK_BYTE &&
+		    fields[i].data_size == 1)
+			return NULL;
+
+	return "Missing a 1 byte \"layout\" field at the layout check byte";
+}
+
+/*
+ * parse_layout_file() - parse a layout description file
+ * @path:	The file
+ * @layout:	Where to save the version and number of fields
+ * @fields:	Where to save the fields. Room for EEPROM_SIZE fields.
+ *
+ * A description holds a "version <number>" line and one line per field, in
+ * EEPROM order. Anything from a '#' to the end of a line is ignored.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int parse_layout_file(const char *path, struct cache_layout *layout,
+			     struct field_desc *fields)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		eprintf("Failed opening %s: %s (%d)\n", path, strerror(errno),
+			-errno);
+		return -1;
+	}
+
+	char line[256];
+	const char *error = NULL;
+	int line_num = 0, offset = 0;
+
+	layout->layout_version = -1;
+	layout->num_of_fields = 0;
+	while (!error && fgets(line, sizeof(line), file)) {
+		line_num++;
+		line[strcspn(line, "#\n")] = '\0';
+
+		char *str = line + strspn(line, " \t");
+		if (*str == '\0')
+			continue;
+
+		if (!strncmp(str, "version", 7) && (str[7] == ' ' ||
+						     str[7] == '\t')) {
+			str += 8;
+			str += strspn(str, " \t");
+			if (strtoi(&str, &layout->layout_version) !=
+			    STRTOI_STR_END ||
+			    layout->layout_version < LAYOUT_CUSTOM ||
+			    layout->layout_version >= LAYOUT_UNRECOGNIZED)
+				error = "Custom layout versions are 5 to 31";
+			continue;
+		}
+
+		if (offset >= EEPROM_SIZE ||
+		    layout->num_of_fields >= NAME_INDEX_SIZE / 2) {
+			error = "Too many fields";
+			continue;
+		}
+
+		struct field_desc *field = &fields[layout->num_of_fields];
+		memset(field, 0, sizeof(*field));
+		error = parse_field(str, field);
+		field->offset = offset;
+		offset += field->data_size;
+		layout->num_of_fields++;
+	}
+
+	fclose(file);
+	if (!error) {
+		line_num = 0;
+		error = check_layout(layout, fields);
+	}
+
+	if (!error)
+		return 0;
+
+	if (line_num)
+		eprintf("Skipping layout %s:%d: %s\n", path, line_num, error);
+	else
+		eprintf("Skipping layout %s: %s\n", path, error);
+
+	return -1;
+}
+
+static bool is_layout_file(const struct dirent *entry)
+{
+	size_t len = strlen(entry->d_name);
+	size_t suffix_len = strlen(LAYOUT_FILE_SUFFIX);
+
+	return entry->d_name[0] != '.' && len > suffix_len &&
+	       !strcmp(entry->d_name + len - suffix_len, LAYOUT_FILE_SUFFIX);
+}
+
+/*
+ * compile_layouts() - compile the layout files of a directory into a cache
+ * @dir:	The layouts directory
+ * @dir_stat:	The status of the directory
+ * @skipped:	Set if any layout file was skipped
+ *
+ * Invalid layout files are reported and skipped, so they don't affect the
+ * other layouts, nor the built-in ones.
+ *
+ * Returns: the allocated cache on success, NULL on failure.
+ */
+static unsigned char *compile_layouts(const char *dir,
+				      const struct stat *dir_stat,
+				      bool *skipped)
+{
+	struct cache_layout layouts[LAYOUT_UNRECOGNIZED];
+	static struct field_desc fields[LAYOUT_UNRECOGNIZED][EEPROM_SIZE];
+	int num_layouts = 0, num_fields = 0;
+	unsigned char *blob = NULL;
+	struct dirent *entry;
+	char path[PATH_MAX];
+	struct stat st;
+
+	DIR *d = opendir(dir);
+	if (!d) {
+		eprintf("Failed opening %s: %s (%d)\n", dir, strerror(errno),
+			-errno);
+		return NULL;
+	}
+
+	while ((entry = readdir(d))) {
+		if (!is_layout_file(entry))
+			continue;
+
+		if (num_layouts == LAYOUT_UNRECOGNIZED - LAYOUT_CUSTOM) {
+			eprintf("Skipping layout %s/%s: Too many layouts\n", dir,
+				entry->d_name);
+			*skipped = true;
+			continue;
+		}
+
+		struct cache_layout *layout = &layouts[num_layouts];
+		memset(layout, 0, sizeof(*layout));
+		snprintf(path, PATH_MAX, "%s/%s", dir, entry->d_name);
+		if (stat(path, &st) < 0 ||
+		    parse_layout_file(path, layout, fields[num_layouts]) < 0) {
+			*skipped = true;
+			continue;
+		}
+
+		int i;
+		for (i = 0; i < num_layouts; i++)
+			if (layouts[i].layout_version == layout->layout_version)
+				break;
+
+		if (i < num_layouts) {
+			eprintf("Skipping layout %s: Layout version %d is also defined by %s\n",
+				path, layout->layout_version, layouts[i].file);
+			*skipped = true;
+			continue;
+		}
+
+		strcpy(layout->file, entry->d_name);
+		layout->mtime = st.st_mtim;
+		layout->file_size = st.st_size;
+		build_name_index(fields[num_layouts], layout->num_of_fields,
+				 &layout->names);
+		num_fields += layout->num_of_fields;
+		num_layouts++;
+	}
+
+	size_t offset = sizeof(struct cache_header) +
+			num_layouts * sizeof(struct cache_layout);
+	size_t size = offset + num_fields * sizeof(struct field_desc);
+
+	blob = calloc(1, size);
+	if (!blob) {
+		perror(STR_ENO_MEM);
+		goto done;
+	}
+
+	struct cache_header *header = (struct cache_header *)blob;
+	memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+	header->format = CACHE_FORMAT;
+	header->desc_size = sizeof(struct field_desc);
+	header->size = size;
+	header->num_layouts = num_layouts;
+	header->dir_mtime = dir_stat->st_mtim;
+	snprintf(header->dir, PATH_MAX, "%s", dir);
+
+	struct cache_layout *cached = (struct cache_layout *)(header + 1);
+	for (int i = 0; i < num_layouts; i++) {
+		cached[i] = layouts[i];
+		cached[i].fields_offset = offset;
+		memcpy(blob + offset, fields[i],
+		       layouts[i].num_of_fields * sizeof(struct field_desc));
+		offset += layouts[i].num_of_fields * sizeof(struct field_desc);
+	}
+
+done:
+	closedir(d);
+	return blob;
+}
+
+/*
+ * cached_layout_is_valid() - check that a layout of a cache can be used in
+ * place, as if it had just been parsed
+ *
+ * The cache is a file which may be corrupt, and its fields and name index are
+ * used without copying them.
+ */
+static bool cached_layout_is_valid(const struct cache_layout *layout,
+				   const struct field_desc *fields)
+{
+	int offset = 0;
+	bool has_empty = false;
+
+	if (!memchr(layout->file, '\0', sizeof(layout->file)) ||
+	    layout->layout_version < LAYOUT_CUSTOM ||
+	    layout->layout_version >= LAYOUT_UNRECOGNIZED ||
+	    layout->num_of_fields >= NAME_INDEX_SIZE / 2)
+		return false;
+
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		const struct field_desc *field = &fields[i];
+		int type;
+
+		for (type = 0; type < ARRAY_LEN(field_types); type++)
+			if (field_types[type].type == field->type)
+				break;
+
+		if (type == ARRAY_LEN(field_types) ||
+		    (field_types[type].size &&
+		     field_types[type].size != field->data_size) ||
+		    !memchr(field->name, '\0', sizeof(field->name)) ||
+		    !memchr(field->short_name, '\0', sizeof(field->short_name)) ||
+		    !valid_short_name(field->short_name) ||
+		    field->offset != offset || field->data_size <= 0 ||
+		    field->data_size > EEPROM_SIZE - offset)
+			return false;
+
+		if (field->type == FIELD_CRC &&
+		    (field->span_start < 0 || field->span_end >= EEPROM_SIZE ||
+		     field->span_end < field->span_start))
+			return false;
+
+		offset += field->data_size;
+	}
+
+	/* lookups probe until an empty entry, and then use the entry found */
+	for (int i = 0; i < NAME_INDEX_SIZE; i++) {
+		const struct name_entry *entry = &layout->names.entries[i];
+
+		if (entry->field == NAME_EMPTY) {
+			has_empty = true;
+			continue;
+		}
+
+		if (entry->name < 0 || entry->name >= 2 * layout->num_of_fields ||
+		    (entry->field != NAME_AMBIGUOUS &&
+		     entry->field != NAME_RESERVED &&
+		     (entry->field < 0 ||
+		      entry->field >= layout->num_of_fields)))
+			return false;
+	}
+
+	return has_empty && !check_layout(layout, fields);
+}
+
+/*
+ * cache_is_valid() - check that a cache was compiled from the current layout
+ * files of a directory, by the same build of the utility, and isn't corrupt
+ */
+static bool cache_is_valid(const unsigned char *blob, size_t size,
+			   const char *dir, const struct stat *dir_stat)
+{
+	const struct cache_header *header = (const struct cache_header *)blob;
+	const struct cache_layout *layouts =
+		(const struct cache_layout *)(header + 1);
+	char path[PATH_MAX];
+	struct stat st;
+
+	if (size < sizeof(*header) ||
+	    memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) ||
+	    header->format != CACHE_FORMAT ||
+	    header->desc_size != sizeof(struct field_desc) ||
+	    header->size != size ||
+	    header->num_layouts > LAYOUT_UNRECOGNIZED - LAYOUT_CUSTOM ||
+	    sizeof(*header) + header->num_layouts * sizeof(*layouts) > size ||
+	    strncmp(header->dir, dir, PATH_MAX) ||
+	    !same_time(&header->dir_mtime, &dir_stat->st_mtim))
+		return false;
+
+	for (int i = 0; i < header->num_layouts; i++) {
+		const struct cache_layout *layout = &layouts[i];
+
+		if (layout->num_of_fields <= 0 ||
+		    layout->fields_offset % __alignof__(struct field_desc) ||
+		    layout->fields_offset + layout->num_of_fields *
+		    sizeof(struct field_desc) > size ||
+		    !cached_layout_is_valid(layout, (const struct field_desc *)
+					    (blob + layout->fields_offset)))
+			return false;
+
+		snprintf(path, PATH_MAX, "%s/%.*s", dir, NAME_MAX,
+			 layout->file);
+		if (stat(path, &st) < 0 || st.st_size != layout->file_size ||
+		    !same_time(&st.st_mtim, &layout->mtime))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * map_cache() - map the cache file, if it is valid
+ *
+ * Returns: the mapped cache, or NULL if there's no valid cache.
+ */
+static const unsigned char *map_cache(const char *path, const char *dir,
+				      const struct stat *dir_stat)
+{
+	struct stat st;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	void *blob = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		blob = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+	if (blob == MAP_FAILED)
+		return NULL;
+
+	if (cache_is_valid(blob, st.st_size, dir, dir_stat))
+		return blob;
+
+	munmap(blob, st.st_size);
+	return NULL;
+}
+
+/*
+ * load_custom_layouts() - register the custom layouts described in a
+ * directory
+ * @dir:	The layouts directory. Nothing is loaded if it doesn't exist.
+ * @cache_dir:	Where the compiled layouts are cached
+ *
+ * The layouts are used straight from the cache if it is up to date.
+ * Otherwise, they are compiled and the cache is replaced. A failure to write
+ * the cache only costs compiling the layouts again on the next run. The cache
+ * isn't written if any layout file was skipped, so the files are compiled and
+ * reported again until they are fixed.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int load_custom_layouts(const char *dir, const char *cache_dir)
+{
+	ASSERT(dir && cache_dir);
+
+	char path[PATH_MAX];
+	struct stat dir_stat;
+
+	if (cache || stat(dir, &dir_stat) < 0)
+		return 0;
+
+	snprintf(path, PATH_MAX, "%s/%s", cache_dir, LAYOUTS_CACHE_FILE);
+	const unsigned char *blob = map_cache(path, dir, &dir_stat);
+	if (!blob) {
+		bool skipped = false;
+		unsigned char *compiled = compile_layouts(dir, &dir_stat,
+							  &skipped);
+		if (!compiled)
+			return -1;
+
+		const struct cache_header *header = (void *)compiled;
+		if (!skipped && make_dirs(cache_dir) == 0)
+			write_file_atomic(path, NULL, 0, compiled, header->size);
+
+		blob = compiled;
+	}
+
+	const struct cache_header *header = (const struct cache_header *)blob;
+	const struct cache_layout *layouts =
+		(const struct cache_layout *)(header + 1);
+	for (int i = 0; i < header->num_layouts; i++) {
+		const struct cache_layout *layout = &layouts[i];
+		const struct field_desc *fields =
+			(const struct field_desc *)(blob + layout->fields_offset);
+
+		if (register_layout(layout->layout_version, fields,
+				    layout->num_of_fields, &layout->names) < 0)
+			eprintf("Skipping layout %s/%s: Invalid layout version %d\n",
+				dir, layout->file, layout->layout_version);
+	}
+
+	cache = blob;
+	return 0;
+}
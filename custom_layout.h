@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CUSTOM_LAYOUT_
+#define _CUSTOM_LAYOUT_
+
+#define DEFAULT_LAYOUTS_DIR	"/etc/eeprom-util/layouts"
+#define LAYOUTS_CACHE_FILE	"layouts.cache"
+#define LAYOUT_FILE_SUFFIX	".layout"
+
+int load_custom_layouts(const char *dir, const char *cache_dir);
+
+#endif
@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The daemon owns the EEPROM devices and keeps a cache of their images.
+ * Clients talk to it over a Unix stream socket, using a struct api whose read
+ * and write operations are requests to the daemon. Reads are served from the
+ * cache, and writes go through the daemon to the device and update the cache.
+ *
+ * Each request is a struct daemon_request, followed by 'size' bytes of data
+ * for writes. Each response is a struct daemon_response, followed by 'size'
+ * bytes of data for reads. A connection can carry any number of requests.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "common.h"
+#include "layout.h"
+#include "daemon.h"
+
+enum daemon_op {
+	DAEMON_READ,
+	DAEMON_WRITE,
+};
+
+/* The most clients served at once. Others wait to be accepted. */
+#define MAX_CLIENTS	64
+/* The most devices cached at once */
+#define MAX_DEVICES	64
+
+struct daemon_request {
+	unsigned char op;
+	unsigned char i2c_bus;
+	unsigned char i2c_addr;
+	unsigned char reserved;
+	unsigned short offset;
+	unsigned short size;
+};
+
+struct daemon_response {
+	int status;			/* 0 or -errno */
+	unsigned short size;
+	unsigned short reserved;
+};
+
+struct cached_device {
+	int i2c_bus;
+	int i2c_addr;
+	bool valid;
+	struct api api;			/* kept open for the daemon's lifetime */
+	unsigned char image[EEPROM_SIZE];
+};
+
+static struct cached_device *devices;
+static int num_devices;
+
+static volatile sig_atomic_t stop_requested;
+static volatile sig_atomic_t flush_requested;
+
+static int recv_all(int fd, void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t ret = recv(fd, (char *)buf + done, size - done, 0);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		done += ret;
+	}
+
+	return 0;
+}
+
+static int send_all(int fd, const void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t ret = send(fd, (const char *)buf + done, size - done,
+				   MSG_NOSIGNAL);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return -1;
+		done += ret;
+	}
+
+	return 0;
+}
+
+static void flush_cache(void)
+{
+	for (int i = 0; i < num_devices; i++)
+		devices[i].valid = false;
+}
+
+/*
+ * get_device() - find the cache entry of a device, or add one
+ *
+ * Returns: a pointer to the entry, NULL if MAX_DEVICES devices are cached
+ * already or on allocation failure.
+ */
+static struct cached_device *get_device(int i2c_bus, int i2c_addr)
+{
+	for (int i = 0; i < num_devices; i++)
+		if (devices[i].i2c_bus == i2c_bus &&
+		    devices[i].i2c_addr == i2c_addr)
+			return &devices[i];
+
+	if (num_devices == MAX_DEVICES)
+		return NULL;
+
+	void *new_alloc = realloc(devices, (num_devices + 1) *
+					   sizeof(*devices));
+	if (!new_alloc)
+		return NULL;
+
+	devices = new_alloc;
+	struct cached_device *device = &devices[num_devices++];
+	memset(device, 0, sizeof(*device));
+	device->i2c_bus = i2c_bus;
+	device->i2c_addr = i2c_addr;
+	api_init(&device->api, i2c_bus, i2c_addr);
+
+	return device;
+}
+
+/*
+ * fill_cache() - read the device into the cache if it isn't there already
+ *
+ * Returns: 0 on success, -errno on failure.
+ */
+static int fill_cache(struct cached_device *device)
+{
+	if (device->valid)
+		return 0;
+
+	errno = 0;
+	if (device->api.read(&device->api, device->image, 0,
+			     EEPROM_SIZE) < 0) {
+		int ret = errno ? -errno : -EIO;
+		/* set up the interface again on the next request */
+		device->api.close(&device->api);
+		return ret;
+	}
+
+	device->valid = true;
+	return 0;
+}
+
+#ifdef ENABLE_WRITE
+/*
+ * write_device() - write to the device and update the cache
+ *
+ * Returns: 0 on success, -errno on failure.
+ */
+static int write_device(struct cached_device *device,
+			const struct daemon_request *req,
+			const unsigned char *data)
+{
+	unsigned char image[EEPROM_SIZE];
+
+	memcpy(image, device->image, EEPROM_SIZE);
+	memcpy(image + req->offset, data, req->size);
+
+	errno = 0;
+	if (device->api.write(&device->api, image, req->offset,
+			      req->size) < 0) {
+		int ret = errno ? -errno : -EIO;
+		device->valid = false;
+		device->api.close(&device->api);
+		return ret;
+	}
+
+	memcpy(device->image + req->offset, data, req->size);
+	return 0;
+}
+#else
+static inline int write_device(struct cached_device *device,
+			       const struct daemon_request *req,
+			       const unsigned char *data)
+{
+	return -EPERM;
+}
+#endif
+
+/*
+ * serve_request() - serve one request of a client
+ *
+ * Returns: 0 on success, -1 if the connection should be closed.
+ */
+static int serve_request(int client)
+{
+	struct daemon_request req;
+	struct daemon_response resp = { 0 };
+	unsigned char data[EEPROM_SIZE];
+
+	if (recv_all(client, &req, sizeof(req)) < 0)
+		return -1;
+
+	if (req.offset >= EEPROM_SIZE ||
+	    req.size > EEPROM_SIZE - req.offset) {
+		resp.status = -EINVAL;
+		return send_all(client, &resp, sizeof(resp));
+	}
+
+	if (req.op == DAEMON_WRITE && recv_all(client, data, req.size) < 0)
+		return -1;
+
+	/* the same devices as the command line accepts */
+	if (req.i2c_bus < MIN_I2C_BUS || req.i2c_bus > MAX_I2C_BUS ||
+	    req.i2c_addr < MIN_I2C_ADDR || req.i2c_addr > MAX_I2C_ADDR) {
+		resp.status = -EINVAL;
+		return send_all(client, &resp, sizeof(resp));
+	}
+
+	struct cached_device *device = get_device(req.i2c_bus, req.i2c_addr);
+	if (!device) {
+		resp.status = -ENOSPC;
+		return send_all(client, &resp, sizeof(resp));
+	}
+
+	switch (req.op) {
+	case DAEMON_READ:
+		resp.status = fill_cache(device);
+		if (resp.status == 0)
+			resp.size = req.size;
+		break;
+	case DAEMON_WRITE:
+		resp.status = write_device(device, &req, data);
+		break;
+	default:
+		resp.status = -EINVAL;
+	}
+
+	if (send_all(client, &resp, sizeof(resp)) < 0)
+		return -1;
+
+	if (resp.size)
+		return send_all(client, device->image + req.offset, resp.size);
+
+	return 0;
+}
+
+static void handle_signal(int signum)
+{
+	if (signum == SIGHUP)
+		flush_requested = 1;
+	else
+		stop_requested = 1;
+}
+
+static int listen_socket(const char *socket_path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+		ieprintf("Socket path \"%s\" is too long", socket_path);
+		return -1;
+	}
+
+	strcpy(addr.sun_path, socket_path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		goto error;
+
+	/* only root may use the daemon, since it can write to devices */
+	mode_t old_umask = umask(0077);
+	unlink(socket_path);
+	int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_umask);
+
+	if (ret < 0 || listen(fd, 16) < 0) {
+		close(fd);
+		goto error;
+	}
+
+	return fd;
+
+error:
+	eprintf("Failed listening on %s: %s (%d)\n", socket_path,
+		strerror(errno), -errno);
+	return -1;
+}
+
+/*
+ * run_daemon() - serve clients until SIGINT or SIGTERM
+ * @socket_path:	The path of the Unix socket to listen on
+ *
+ * The listening socket and the connected clients are polled together, and a
+ * request is served whenever a client sends one, so clients which stay
+ * connected between requests don't keep others waiting.
+ *
+ * SIGHUP drops all cached images, e.g. after the EEPROMs were written without
+ * going through the daemon.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int run_daemon(const char *socket_path)
+{
+	ASSERT(socket_path);
+
+	struct sigaction action = { .sa_handler = handle_signal };
+	/* a client which doesn't send its whole request can't block others */
+	struct timeval timeout = { .tv_sec = 1 };
+	/* the listening socket, followed by the clients */
+	struct pollfd fds[1 + MAX_CLIENTS];
+	int num_fds = 1;
+
+	int fd = listen_socket(socket_path);
+	if (fd < 0)
+		return -1;
+
+	/* no SA_RESTART, so poll() returns when a signal arrives */
+	sigaction(SIGHUP, &action, NULL);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	fds[0] = (struct pollfd) { .fd = fd, .events = POLLIN };
+	while (!stop_requested) {
+		if (flush_requested) {
+			flush_cache();
+			flush_requested = 0;
+		}
+
+		/* stop accepting while full, until a client disconnects */
+		fds[0].events = num_fds < ARRAY_LEN(fds) ? POLLIN : 0;
+		if (poll(fds, num_fds, -1) < 0)
+			continue;
+
+		for (int i = num_fds - 1; i > 0; i--) {
+			if (!fds[i].revents)
+				continue;
+
+			if (serve_request(fds[i].fd) < 0) {
+				close(fds[i].fd);
+				fds[i] = fds[--num_fds];
+			}
+		}
+
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		int client = accept(fd, NULL, NULL);
+		if (client < 0)
+			continue;
+
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+			   sizeof(timeout));
+		fds[num_fds++] = (struct pollfd) { .fd = client,
+						   .events = POLLIN };
+	}
+
+	for (int i = 1; i < num_fds; i++)
+		close(fds[i].fd);
+
+	close(fd);
+	unlink(socket_path);
+
+	for (int i = 0; i < num_devices; i++)
+		devices[i].api.close(&devices[i].api);
+	free(devices);
+
+	return 0;
+}
+
+static const char *client_socket_path;
+
+static int daemon_connect(struct api *api)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (api->fd >= 0)
+		return 0;
+
+	strncpy(addr.sun_path, client_socket_path, sizeof(addr.sun_path) - 1);
+	api->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (api->fd < 0)
+		return -1;
+
+	if (connect(api->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		int saved_errno = errno;
+		close(api->fd);
+		api->fd = -1;
+		eprintf("Error, daemon at %s is not accessible: %s (%d)\n",
+			client_socket_path, strerror(saved_errno),
+			-saved_errno);
+		errno = saved_errno;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void daemon_close(struct api *api)
+{
+	ASSERT(api);
+
+	if (api->fd >= 0)
+		close(api->fd);
+
+	api->fd = -1;
+}
+
+/*
+ * daemon_transfer() - send a request to the daemon and receive its response
+ * @api:	The client api
+ * @op:		The request
+ * @buf:	The source of written data or the destination of read data.
+ *		Indexed by offset, like in the other api implementations.
+ *
+ * Returns: the number of bytes transferred, -1 on failure with errno set.
+ */
+static int daemon_transfer(struct api *api, enum daemon_op op,
+			   unsigned char *buf, int offset, int size)
+{
+	struct daemon_request req = {
+		.op		= op,
+		.i2c_bus	= api->i2c_bus,
+		.i2c_addr	= api->i2c_addr,
+		.offset		= offset,
+		.size		= size,
+	};
+	struct daemon_response resp;
+	int ret;
+
+	/*
+	 * The daemon may have closed the connection since the last request,
+	 * i.e. when it restarted, so a failed exchange is retried once on a
+	 * new connection.
+	 */
+	for (int attempt = 0; attempt < 2; attempt++) {
+		if (daemon_connect(api) < 0)
+			return -1;
+
+		errno = 0;
+		ret = send_all(api->fd, &req, sizeof(req));
+		if (ret == 0 && op == DAEMON_WRITE)
+			ret = send_all(api->fd, buf + offset, size);
+		if (ret == 0)
+			ret = recv_all(api->fd, &resp, sizeof(resp));
+		if (ret == 0)
+			break;
+
+		daemon_close(api);
+	}
+
+	if (ret < 0) {
+		errno = errno ? errno : EPIPE;
+		return -1;
+	}
+
+	if (resp.status < 0) {
+		errno = -resp.status;
+		return -1;
+	}
+
+	if (resp.size && recv_all(api->fd, buf + offset, resp.size) < 0) {
+		errno = errno ? errno : EPIPE;
+		daemon_close(api);
+		return -1;
+	}
+
+	return size;
+}
+
+static int daemon_read(struct api *api, unsigned char *buf, int offset,
+		       int size)
+{
+	ASSERT(api && buf);
+	return daemon_transfer(api, DAEMON_READ, buf, offset, size);
+}
+
+static int daemon_write(struct api *api, unsigned char *buf, int offset,
+			int size)
+{
+	ASSERT(api && buf);
+	return daemon_transfer(api, DAEMON_WRITE, buf, offset, size);
+}
+
+/*
+ * daemon_api_init() - init an api which accesses the device via the daemon
+ *
+ * Listing and scanning devices still access the buses directly.
+ */
+void daemon_api_init(struct api *api, int i2c_bus, int i2c_addr,
+		     const char *socket_path)
+{
+	api_init(api, i2c_bus, i2c_addr);
+
+	client_socket_path = socket_path;
+	api->read = daemon_read;
+	api->write = daemon_write;
+	api->close = daemon_close;
+}
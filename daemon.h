@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DAEMON_
+#define _DAEMON_
+
+#include "api.h"
+
+#define DEFAULT_DAEMON_SOCKET	"/run/eeprom-util.sock"
+
+int run_daemon(const char *socket_path);
+void daemon_api_init(struct api *api, int i2c_bus, int i2c_addr,
+		     const char *socket_path);
+
+#endif
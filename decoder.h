@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DECODER_
+#define _DECODER_
+
+#include "layout.h"
+#include "output.h"
+
+/*
+ * A decoder formats an entire image of a built in layout in one print format
+ * into a buffer. Decoders are generated at build time by gen_decoders.c from
+ * the layout tables, with the offsets, sizes and types of the fields, and the
+ * padded names, built in. They print exactly what the field ops print.
+ */
+struct decoder {
+	/* returns the end of the output */
+	char *(*decode)(const unsigned char *data, char *out,
+			const char *prefix);
+	int size;		/* the largest output, without the prefixes */
+	int num_prefixes;	/* the number of lines beginning with a prefix */
+};
+
+const struct decoder *get_decoder(enum layout_version layout_version,
+				  enum print_format print_format);
+
+#endif
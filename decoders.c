@@ -0,0 +1,920 @@
+/* Generated by gen_decoders.c from builtin_layouts.h. Do not edit. */
+
+#include "common.h"
+#include "decoder.h"
+
+static char *decode_layout_legacy_default(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "MAC address                   ", 30);
+	out = put_hex_delim(out, data + 0, 6, ':');
+	out = put_str(out, "\nBoard Revision                ", 31);
+	out = put_hex(out, data + 6, 2);
+	out = put_str(out, "\nSerial Number                 ", 31);
+	out = put_hex(out, data + 8, 8);
+	out = put_str(out, "\nBoard Configuration           ", 31);
+	out = put_ascii(out, data + 16, 64);
+	out = put_str(out, "\nReserved fields               (176 bytes)\n", 43);
+	return out;
+}
+
+static char *decode_layout_legacy_dump(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "MAC address=", 12);
+	out = put_hex_delim(out, data + 0, 6, ':');
+	out = put_str(out, "\nBoard Revision=", 16);
+	out = put_hex(out, data + 6, 2);
+	out = put_str(out, "\nSerial Number=", 15);
+	out = put_hex(out, data + 8, 8);
+	out = put_str(out, "\nBoard Configuration=", 21);
+	out = put_ascii(out, data + 16, 64);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_legacy_shell(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC=", 4);
+	out = put_hex_delim(out, data + 0, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "REV=", 4);
+	out = put_hex(out, data + 6, 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex(out, data + 8, 8);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "CONF=", 5);
+	out = put_ascii_shell(out, data + 16, 64);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_legacy_udev(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC=", 4);
+	out = put_hex_delim(out, data + 0, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "REV=", 4);
+	out = put_hex(out, data + 6, 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex(out, data + 8, 8);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "CONF=", 5);
+	out = put_ascii_udev(out, data + 16, 64);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v1_default(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision                ", 30);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision                ", 31);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address               ", 31);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address               ", 31);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date               ", 31);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number                 ", 31);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\nReserved fields               (96 bytes)\nProduct Name                  ", 72);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1            ", 31);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2            ", 31);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3            ", 31);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\nReserved fields               (64 bytes)\n", 42);
+	return out;
+}
+
+static char *decode_layout_v1_dump(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision=", 15);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision=", 16);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address=", 17);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address=", 17);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date=", 17);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number=", 15);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\nProduct Name=", 14);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1=", 20);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2=", 20);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3=", 20);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v1_shell(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_shell(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_shell(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_shell(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_shell(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v1_udev(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_udev(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_udev(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_udev(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_udev(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v2_default(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision                ", 30);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision                ", 31);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address               ", 31);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address               ", 31);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date               ", 31);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number                 ", 31);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n3rd MAC Address (WIFI)        ", 31);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n4th MAC Address (Bluetooth)   ", 31);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\nLayout Version                ", 31);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\nReserved fields               (83 bytes)\nProduct Name                  ", 72);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1            ", 31);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2            ", 31);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3            ", 31);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\nReserved fields               (64 bytes)\n", 42);
+	return out;
+}
+
+static char *decode_layout_v2_dump(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision=", 15);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision=", 16);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address=", 17);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address=", 17);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date=", 17);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number=", 15);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n3rd MAC Address (WIFI)=", 24);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n4th MAC Address (Bluetooth)=", 29);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\nLayout Version=", 16);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\nProduct Name=", 14);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1=", 20);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2=", 20);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3=", 20);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v2_shell(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC3=", 5);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC4=", 5);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "LAYOUT=", 7);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_shell(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_shell(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_shell(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_shell(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v2_udev(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC3=", 5);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC4=", 5);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "LAYOUT=", 7);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_udev(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_udev(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_udev(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_udev(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v3_default(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision                ", 30);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision                ", 31);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address               ", 31);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address               ", 31);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date               ", 31);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number                 ", 31);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n3rd MAC Address (WIFI)        ", 31);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n4th MAC Address (Bluetooth)   ", 31);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\nLayout Version                ", 31);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\nCompuLab EEPROM ID            ", 31);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\nReserved fields               (80 bytes)\nProduct Name                  ", 72);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1            ", 31);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2            ", 31);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3            ", 31);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\nReserved fields               (64 bytes)\n", 42);
+	return out;
+}
+
+static char *decode_layout_v3_dump(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision=", 15);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision=", 16);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address=", 17);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address=", 17);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date=", 17);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number=", 15);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n3rd MAC Address (WIFI)=", 24);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n4th MAC Address (Bluetooth)=", 29);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\nLayout Version=", 16);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\nCompuLab EEPROM ID=", 20);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\nProduct Name=", 14);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1=", 20);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2=", 20);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3=", 20);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v3_shell(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC3=", 5);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC4=", 5);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "LAYOUT=", 7);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "ID=", 3);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_shell(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_shell(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_shell(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_shell(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v3_udev(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC3=", 5);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC4=", 5);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "LAYOUT=", 7);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "ID=", 3);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_udev(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_udev(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_udev(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_udev(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v4_default(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision                ", 30);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision                ", 31);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address               ", 31);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address               ", 31);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date               ", 31);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number                 ", 31);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n3rd MAC Address (WIFI)        ", 31);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n4th MAC Address (Bluetooth)   ", 31);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\nLayout Version                ", 31);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\nCompuLab EEPROM ID            ", 31);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\n5th MAC Address               ", 31);
+	out = put_hex_delim(out, data + 48, 6, ':');
+	out = put_str(out, "\n6th MAC Address               ", 31);
+	out = put_hex_delim(out, data + 54, 6, ':');
+	out = put_str(out, "\nScratchpad                    ", 31);
+	out = put_hex(out, data + 60, 4);
+	out = put_str(out, "\nReserved fields               (64 bytes)\nProduct Name                  ", 72);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1            ", 31);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2            ", 31);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3            ", 31);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\nProduct Options #4            ", 31);
+	out = put_ascii(out, data + 192, 16);
+	out = put_str(out, "\nProduct Options #5            ", 31);
+	out = put_ascii(out, data + 208, 16);
+	out = put_str(out, "\nReserved fields               (32 bytes)\n", 42);
+	return out;
+}
+
+static char *decode_layout_v4_dump(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	out = put_str(out, "Major Revision=", 15);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\nMinor Revision=", 16);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n1st MAC Address=", 17);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n2nd MAC Address=", 17);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\nProduction Date=", 17);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\nSerial Number=", 15);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n3rd MAC Address (WIFI)=", 24);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n4th MAC Address (Bluetooth)=", 29);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\nLayout Version=", 16);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\nCompuLab EEPROM ID=", 20);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\n5th MAC Address=", 17);
+	out = put_hex_delim(out, data + 48, 6, ':');
+	out = put_str(out, "\n6th MAC Address=", 17);
+	out = put_hex_delim(out, data + 54, 6, ':');
+	out = put_str(out, "\nScratchpad=", 12);
+	out = put_hex(out, data + 60, 4);
+	out = put_str(out, "\nProduct Name=", 14);
+	out = put_ascii(out, data + 128, 16);
+	out = put_str(out, "\nProduct Options #1=", 20);
+	out = put_ascii(out, data + 144, 16);
+	out = put_str(out, "\nProduct Options #2=", 20);
+	out = put_ascii(out, data + 160, 16);
+	out = put_str(out, "\nProduct Options #3=", 20);
+	out = put_ascii(out, data + 176, 16);
+	out = put_str(out, "\nProduct Options #4=", 20);
+	out = put_ascii(out, data + 192, 16);
+	out = put_str(out, "\nProduct Options #5=", 20);
+	out = put_ascii(out, data + 208, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v4_shell(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC3=", 5);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC4=", 5);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "LAYOUT=", 7);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "ID=", 3);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC5=", 5);
+	out = put_hex_delim(out, data + 48, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC6=", 5);
+	out = put_hex_delim(out, data + 54, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SPAD=", 5);
+	out = put_hex(out, data + 60, 4);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_shell(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_shell(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_shell(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_shell(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT4=", 5);
+	out = put_ascii_shell(out, data + 192, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT5=", 5);
+	out = put_ascii_shell(out, data + 208, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static char *decode_layout_v4_udev(const unsigned char *data, char *out,
+				const char *prefix)
+{
+	int prefix_len = strlen(prefix);
+
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAJOR=", 6);
+	out = put_version(out, data + 0);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MINOR=", 6);
+	out = put_version(out, data + 2);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC1=", 5);
+	out = put_hex_delim(out, data + 4, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC2=", 5);
+	out = put_hex_delim(out, data + 10, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "DATE=", 5);
+	out = put_date(out, data + 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SN=", 3);
+	out = put_hex_rev(out, data + 20, 12);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC3=", 5);
+	out = put_hex_delim(out, data + 32, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC4=", 5);
+	out = put_hex_delim(out, data + 38, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "LAYOUT=", 7);
+	out = put_hex(out, data + 44, 1);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "ID=", 3);
+	out = put_hex(out, data + 45, 3);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC5=", 5);
+	out = put_hex_delim(out, data + 48, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "MAC6=", 5);
+	out = put_hex_delim(out, data + 54, 6, ':');
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "SPAD=", 5);
+	out = put_hex(out, data + 60, 4);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "NAME=", 5);
+	out = put_ascii_udev(out, data + 128, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT1=", 5);
+	out = put_ascii_udev(out, data + 144, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT2=", 5);
+	out = put_ascii_udev(out, data + 160, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT3=", 5);
+	out = put_ascii_udev(out, data + 176, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT4=", 5);
+	out = put_ascii_udev(out, data + 192, 16);
+	out = put_str(out, "\n", 1);
+	out = put_str(out, prefix, prefix_len);
+	out = put_str(out, "OPT5=", 5);
+	out = put_ascii_udev(out, data + 208, 16);
+	out = put_str(out, "\n", 1);
+	return out;
+}
+
+static const struct decoder decoders[LAYOUT_CUSTOM][4] = {
+	[LAYOUT_LEGACY] = {
+		[FORMAT_DEFAULT] = { decode_layout_legacy_default, 267, 0 },
+		[FORMAT_DUMP] = { decode_layout_legacy_dump, 166, 0 },
+		[FORMAT_SHELL] = { decode_layout_legacy_shell, 315, 4 },
+		[FORMAT_UDEV] = { decode_layout_legacy_udev, 121, 4 },
+	},
+	[LAYOUT_VER1] = {
+		[FORMAT_DEFAULT] = { decode_layout_v1_default, 542, 0 },
+		[FORMAT_DUMP] = { decode_layout_v1_dump, 322, 0 },
+		[FORMAT_SHELL] = { decode_layout_v1_shell, 410, 10 },
+		[FORMAT_UDEV] = { decode_layout_v1_udev, 210, 10 },
+	},
+	[LAYOUT_VER2] = {
+		[FORMAT_DEFAULT] = { decode_layout_v2_default, 671, 0 },
+		[FORMAT_DUMP] = { decode_layout_v2_dump, 427, 0 },
+		[FORMAT_SHELL] = { decode_layout_v2_shell, 466, 13 },
+		[FORMAT_UDEV] = { decode_layout_v2_udev, 266, 13 },
+	},
+	[LAYOUT_VER3] = {
+		[FORMAT_DEFAULT] = { decode_layout_v3_default, 708, 0 },
+		[FORMAT_DUMP] = { decode_layout_v3_dump, 453, 0 },
+		[FORMAT_SHELL] = { decode_layout_v3_shell, 476, 14 },
+		[FORMAT_UDEV] = { decode_layout_v3_udev, 276, 14 },
+	},
+	[LAYOUT_VER4] = {
+		[FORMAT_DEFAULT] = { decode_layout_v4_default, 937, 0 },
+		[FORMAT_DUMP] = { decode_layout_v4_dump, 613, 0 },
+		[FORMAT_SHELL] = { decode_layout_v4_shell, 680, 19 },
+		[FORMAT_UDEV] = { decode_layout_v4_udev, 380, 19 },
+	},
+};
+
+const struct decoder *get_decoder(enum layout_version layout_version,
+				  enum print_format print_format)
+{
+	if ((int)layout_version < 0 ||
+	    layout_version >= ARRAY_LEN(decoders) ||
+	    (int)print_format < 0 ||
+	    print_format >= ARRAY_LEN(decoders[0]) ||
+	    !decoders[layout_version][print_format].decode)
+		return NULL;
+
+	return &decoders[layout_version][print_format];
+}
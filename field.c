@@ -21,45 +21,34 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <ctype.h>
 #include "common.h"
 #include "field.h"
+#include "output.h"
+#include "json.h"
 
 // Macro for printing field's input value error messages
 #define iveprintf(str, value, name) \
 	ieprintf("Invalid value \"%s\" for field \"%s\" - " str, value, name);
 
-static void __print_bin(const struct field *field,
-			char *delimiter, bool reverse)
-{
-	ASSERT(field && field->data && delimiter);
-
-	int i;
-	int from = reverse ? field->data_size - 1 : 0;
-	int to = reverse ? 0 : field->data_size - 1;
-	for (i = from; i != to; reverse ? i-- : i++)
-		printf("%02x%s", field->data[i], delimiter);
-
-	printf("%02x\n", field->data[i]);
-}
-
 static int __update_bin(struct field *field, const char *value, bool reverse)
 {
-	ASSERT(field && field->data && field->name && value);
+	ASSERT(field && field->data && field->desc && value);
 
 	int len = strlen(value);
 	int i = reverse ? len - 1 : 0;
 
 	/* each two characters in the string are fit in one byte */
-	if (len > field->data_size * 2) {
-		iveprintf("Value is too long", value, field->name);
+	if (len > field->desc->data_size * 2) {
+		iveprintf("Value is too long", value, field->desc->name);
 		return -1;
 	}
 
 	/* pad with zeros */
-	memset(field->data, 0, field->data_size);
+	memset(field->data, 0, field->desc->data_size);
 
 	/* i - string iterator, j - data iterator */
-	for (int j = 0; j < field->data_size; j++) {
+	for (int j = 0; j < field->desc->data_size; j++) {
 		int byte = 0;
 		char tmp[3] = { 0, 0, 0 };
 
@@ -77,7 +66,7 @@ static int __update_bin(struct field *field, const char *value, bool reverse)
 
 		char *str = tmp;
 		if (strtoi_base(&str, &byte, 16) < 0 || byte < 0 || byte >> 8) {
-			iveprintf("Syntax error", value, field->name);
+			iveprintf("Syntax error", value, field->desc->name);
 			return -1;
 		}
 
@@ -90,15 +79,15 @@ static int __update_bin(struct field *field, const char *value, bool reverse)
 
 static int __update_bin_delim(struct field *field, char *value, char delimiter)
 {
-	ASSERT(field && field->data && field->name && value);
+	ASSERT(field && field->data && field->desc && value);
 
 	int i, val;
 	char *bin = value;
 
-	for (i = 0; i < (field->data_size - 1); i++) {
+	for (i = 0; i < (field->desc->data_size - 1); i++) {
 		if (strtoi_base(&bin, &val, 16) != STRTOI_STR_CON ||
 		    *bin != delimiter || val < 0 || val >> 8) {
-			iveprintf("Syntax error", value, field->name);
+			iveprintf("Syntax error", value, field->desc->name);
 			return -1;
 		}
 
@@ -108,7 +97,7 @@ static int __update_bin_delim(struct field *field, char *value, char delimiter)
 
 	if (strtoi_base(&bin, &val, 16) != STRTOI_STR_END ||
 	    val < 0 || val >> 8) {
-		iveprintf("Syntax error", value, field->name);
+		iveprintf("Syntax error", value, field->desc->name);
 		return -1;
 	}
 
@@ -128,7 +117,14 @@ static int __update_bin_delim(struct field *field, char *value, char delimiter)
  */
 static void print_bin(const struct field *field)
 {
-	__print_bin(field, "", false);
+	ASSERT(field && field->data);
+
+	int size = field->desc->data_size;
+	char *out = out_reserve(2 * size + 1);
+
+	out = put_hex(out, field->data, size);
+	*out++ = '\n';
+	out_commit(out);
 }
 
 /**
@@ -140,27 +136,31 @@ static void print_bin_raw(const struct field *field)
 {
 	ASSERT(field && field->data);
 
-	printf("     0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f"
-	       "     0123456789abcdef\n");
+	out_str("     0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f"
+		"     0123456789abcdef\n");
 	int i, j;
 
 	for (i = 0; i < 256; i += 16) {
-		printf("%02x: ", i);
+		char *out = out_reserve(sizeof("00: ") - 1 + 16 * 3 + 4 + 16 + 1);
+
+		out = put_hex_byte(out, i);
+		out = put_str(out, ": ", 2);
 		for (j = 0; j < 16; j++) {
-			printf("%02x", field->data[i+j]);
-			printf(" ");
+			out = put_hex_byte(out, field->data[i+j]);
+			*out++ = ' ';
 		}
-		printf("    ");
+		out = put_str(out, "    ", 4);
 
 		for (j = 0; j < 16; j++) {
 			if (field->data[i+j] == 0x00 || field->data[i+j] == 0xff)
-				printf(".");
+				*out++ = '.';
 			else if (field->data[i+j] < 32 || field->data[i+j] >= 127)
-				printf("?");
+				*out++ = '?';
 			else
-				printf("%c", field->data[i+j]);
+				*out++ = field->data[i+j];
 		}
-		printf("\n");
+		*out++ = '\n';
+		out_commit(out);
 	}
 }
 
@@ -188,7 +188,14 @@ static int update_bin(struct field *field, char *value)
  */
 static void print_bin_rev(const struct field *field)
 {
-	__print_bin(field, "", true);
+	ASSERT(field && field->data);
+
+	int size = field->desc->data_size;
+	char *out = out_reserve(2 * size + 1);
+
+	out = put_hex_rev(out, field->data, size);
+	*out++ = '\n';
+	out_commit(out);
 }
 
 /**
@@ -222,12 +229,12 @@ static void print_bin_ver(const struct field *field)
 {
 	ASSERT(field && field->data);
 
-	if ((field->data[0] == 0xff) && (field->data[1] == 0xff)) {
-		field->data[0] = 0;
-		field->data[1] = 0;
-	}
+	/* a blank version is printed as 0.00, leaving the image as is */
+	char *out = out_reserve(sizeof("655.35"));
 
-	printf("%#.2f\n", (field->data[1] << 8 | field->data[0]) / 100.0);
+	out = put_version(out, field->data);
+	*out++ = '\n';
+	out_commit(out);
 }
 
 /**
@@ -247,35 +254,35 @@ static void print_bin_ver(const struct field *field)
  */
 static int update_bin_ver(struct field *field, char *value)
 {
-	ASSERT(field && field->data && field->name && value);
+	ASSERT(field && field->data && field->desc && value);
 
 	char *version = value;
 	int num, remainder;
 
 	if (strtoi(&version, &num) != STRTOI_STR_CON && *version != '.') {
-		iveprintf("Syntax error", value, field->name);
+		iveprintf("Syntax error", value, field->desc->name);
 		return -1;
 	}
 
 	version++;
 	if (strtoi(&version, &remainder) != STRTOI_STR_END) {
-		iveprintf("Syntax error", value, field->name);
+		iveprintf("Syntax error", value, field->desc->name);
 		return -1;
 	}
 
 	if (num < 0 || remainder < 0) {
-		iveprintf("Version must be positive", value, field->name);
+		iveprintf("Version must be positive", value, field->desc->name);
 		return -1;
 	}
 
 	if (remainder > 99) {
-		iveprintf("Minor version is 1-2 digits", value, field->name);
+		iveprintf("Minor version is 1-2 digits", value, field->desc->name);
 		return -1;
 	}
 
 	num = num * 100 + remainder;
 	if (num >> 16) {
-		iveprintf("Version is too big", value, field->name);
+		iveprintf("Version is too big", value, field->desc->name);
 		return -1;
 	}
 
@@ -296,7 +303,14 @@ static int update_bin_ver(struct field *field, char *value)
  */
 static void print_mac(const struct field *field)
 {
-	__print_bin(field, ":", false);
+	ASSERT(field && field->data);
+
+	int size = field->desc->data_size;
+	char *out = out_reserve(3 * size);
+
+	out = put_hex_delim(out, field->data, size, ':');
+	*out++ = '\n';
+	out_commit(out);
 }
 
 /**
@@ -326,13 +340,11 @@ static void print_date(const struct field *field)
 {
 	ASSERT(field && field->data);
 
-	printf("%02d/", field->data[0]);
-	if (field->data[1] >= 1 && field->data[1] <= 12)
-		printf("%s", months[field->data[1] - 1]);
-	else
-		printf("BAD");
+	char *out = out_reserve(sizeof("255/BAD/65535"));
 
-	printf("/%d\n", field->data[3] << 8 | field->data[2]);
+	out = put_date(out, field->data);
+	*out++ = '\n';
+	out_commit(out);
 }
 
 static int validate_date(unsigned char day, unsigned char month,
@@ -397,24 +409,24 @@ static int validate_date(unsigned char day, unsigned char month,
  */
 static int update_date(struct field *field, char *value)
 {
-	ASSERT(field && field->data && field->name && value);
+	ASSERT(field && field->data && field->desc && value);
 
 	char *date = value;
 	int day, month, year;
 
 	if (strtoi(&date, &day) != STRTOI_STR_CON || *date != '/') {
-		iveprintf("Syntax error", value, field->name);
+		iveprintf("Syntax error", value, field->desc->name);
 		return -1;
 	}
 
 	if (day == 0) {
-		iveprintf("Invalid day", value, field->name);
+		iveprintf("Invalid day", value, field->desc->name);
 		return -1;
 	}
 
 	date++;
 	if (strlen(date) < 4 || *(date + 3) != '/') {
-		iveprintf("Syntax error", value, field->name);
+		iveprintf("Syntax error", value, field->desc->name);
 		return -1;
 	}
 
@@ -423,23 +435,23 @@ static int update_date(struct field *field, char *value)
 			break;
 
 	if (strncmp(date, months[month - 1], 3)) {
-		iveprintf("Invalid month", value, field->name);
+		iveprintf("Invalid month", value, field->desc->name);
 		return -1;
 	}
 
 	date += 4;
 	if (strtoi(&date, &year) != STRTOI_STR_END) {
-		iveprintf("Syntax error", value, field->name);
+		iveprintf("Syntax error", value, field->desc->name);
 		return -1;
 	}
 
 	if (validate_date(day, month - 1, year)) {
-		iveprintf("Invalid date", value, field->name);
+		iveprintf("Invalid date", value, field->desc->name);
 		return -1;
 	}
 
 	if (year >> 16) {
-		iveprintf("Year overflow", value, field->name);
+		iveprintf("Year overflow", value, field->desc->name);
 		return -1;
 	}
 
@@ -459,24 +471,12 @@ static void print_ascii(const struct field *field)
 {
 	ASSERT(field && field->data);
 
-	char format[8];
-	int *str = (int*)field->data;
-	int pattern = *str;
-	/* assuming field->data_size is a multiple of 32bit! */
-	int block_count = field->data_size / sizeof(int);
-	char *print_buf = "";
-
-	/* check if str is trivial (contains only 0's or only 0xff's), if so print nothing */
-	for (int i = 0; i < block_count - 1; i++) {
-		str++;
-		if (*str != pattern || (pattern != 0 && pattern != -1)) {
-			print_buf = (char*)field->data;
-			break;
-		}
-	}
+	int size = field->desc->data_size;
+	char *out = out_reserve(size + 1);
 
-	sprintf(format, "%%.%ds\n", field->data_size);
-	printf(format, print_buf);
+	out = put_ascii(out, field->data, size);
+	*out++ = '\n';
+	out_commit(out);
 }
 
 /**
@@ -488,15 +488,15 @@ static void print_ascii(const struct field *field)
  */
 static int update_ascii(struct field *field, char *value)
 {
-	ASSERT(field && field->data && field->name && value);
+	ASSERT(field && field->data && field->desc && value);
 
-	if (strlen(value) >= field->data_size) {
-		iveprintf("Value is too long", value, field->name);
+	if (strlen(value) >= field->desc->data_size) {
+		iveprintf("Value is too long", value, field->desc->name);
 		return -1;
 	}
 
-	strncpy((char *)field->data, value, field->data_size - 1);
-	field->data[field->data_size - 1] = '\0';
+	strncpy((char *)field->data, value, field->desc->data_size - 1);
+	field->data[field->desc->data_size - 1] = '\0';
 
 	return 0;
 }
@@ -513,33 +513,63 @@ static int update_ascii(struct field *field, char *value)
 static void print_reserved(const struct field *field)
 {
 	ASSERT(field);
-	printf("(%d bytes)\n", field->data_size);
+
+	char *out = out_reserve(sizeof("(4294967295 bytes)\n"));
+
+	*out++ = '(';
+	out = put_uint(out, field->desc->data_size);
+	out = put_str(out, " bytes)\n", 8);
+	out_commit(out);
 }
 
 /**
- * clear_field() - clear a field
+ * print_crc() - print the value of a field from type "crc"
  *
- * A cleared field is defined by having all bytes set to 0xff.
+ * Print the stored CRC32C, which is little endian, as a hexadecimal number.
+ * Sample output: e3069283
  *
- * @field:	an initialized field to clear
+ * @field:	an initialized field to print
  */
-static void clear_field(struct field *field)
+static void print_crc(const struct field *field)
 {
 	ASSERT(field && field->data);
-	memset(field->data, 0xff, field->data_size);
+
+	char *out = out_reserve(2 * 4 + 1);
+
+	out = put_hex_rev(out, field->data, 4);
+	*out++ = '\n';
+	out_commit(out);
 }
 
 /**
- * get_data_size() - get the size of field's data
+ * update_crc() - reject updates of a checksum field
+ *
+ * Checksums are computed whenever the EEPROM contents are updated.
  *
  * @field:	an initialized field
+ * @value:	the new value
  *
- * return: the size of field's data
+ * Returns -1.
  */
-static int get_data_size(const struct field *field)
+static int update_crc(struct field *field, char *value)
 {
-	ASSERT(field);
-	return field->data_size;
+	ASSERT(field && field->desc && value);
+
+	iveprintf("Checksums are computed", value, field->desc->name);
+	return -1;
+}
+
+/**
+ * clear_field() - clear a field
+ *
+ * A cleared field is defined by having all bytes set to 0xff.
+ *
+ * @field:	an initialized field to clear
+ */
+static void clear_field(struct field *field)
+{
+	ASSERT(field && field->data);
+	memset(field->data, 0xff, field->desc->data_size);
 }
 
 /**
@@ -552,94 +582,289 @@ static int get_data_size(const struct field *field)
  */
 static bool is_named(const struct field *field, const char *str)
 {
-	ASSERT(field && field->name && field->short_name && str);
+	ASSERT(field && field->desc && str);
 
-	if (field->type != FIELD_RESERVED && field->type != FIELD_RAW &&
-	    (!strcmp(field->name, str) || !strcmp(field->short_name, str)))
+	if (field->desc->type != FIELD_RESERVED && field->desc->type != FIELD_RAW &&
+	    (!strcmp(field->desc->name, str) || !strcmp(field->desc->short_name, str)))
 		return true;
 
 	return false;
 }
 
+#define NAME_COLUMN_WIDTH	30
+
 /**
- * print_field() - print the given field using the given string format
+ * print_default() - print the given field using the default format
+ *
+ * The name is padded to the width of the name column.
  *
  * @field:	an initialized field to to print
- * @format:	the string format for printf()
  */
-static void print_field(const struct field *field, char *format)
+static void print_default(const struct field *field)
 {
-	ASSERT(field && field->name && field->ops && format);
+	ASSERT(field && field->desc && field->ops);
+
+	int len = strlen(field->desc->name);
+	char *out = out_reserve(len + NAME_COLUMN_WIDTH);
 
-	printf(format, field->name);
+	out = put_str(out, field->desc->name, len);
+	for (; len < NAME_COLUMN_WIDTH; len++)
+		*out++ = ' ';
+
+	out_commit(out);
 	field->ops->print_value(field);
 }
 
 /**
- * print_default() - print the given field using the default format
+ * print_dump() - print the given field using the dump format
  *
- * @field:	an initialized field to to print
+ * @field:	an initialized field to dump
  */
-static void print_default(const struct field *field)
+static void print_dump(const struct field *field)
 {
-	print_field(field, "%-30s");
+	/* checksums are computed, so a dump can be written back as is */
+	if (field->desc->type == FIELD_RESERVED ||
+	    field->desc->type == FIELD_CRC)
+		return;
+
+	int len = strlen(field->desc->name);
+	char *out = out_reserve(len + 1);
+
+	out = put_str(out, field->desc->name, len);
+	*out++ = '=';
+	out_commit(out);
+	field->ops->print_value(field);
 }
 
+static const char *print_prefix = DEFAULT_PRINT_PREFIX;
+
 /**
- * print_dump() - print the given field using the dump format
+ * print_property() - print the given field as a KEY=value property
  *
- * @field:	an initialized field to dump
+ * The key is the prefix followed by the upper case short name of the field.
+ * Values other than ASCII consist of safe characters only. ASCII values are
+ * single quoted for the shell, and have unprintable characters replaced for
+ * udev, which doesn't unescape values.
+ *
+ * Sample output: EEPROM_MAC1=00:01:c0:13:91:d0
+ *		  EEPROM_NAME='CM-FX6'
+ *
+ * @field:	an initialized field to print
+ * @shell:	true for shell assignments, false for udev properties
  */
-static void print_dump(const struct field *field)
+static void print_property(const struct field *field, bool shell)
+{
+	ASSERT(field && field->desc && field->data);
+
+	if (field->desc->type == FIELD_RESERVED)
+		return;
+
+	int size = field->desc->data_size;
+	char *out = out_reserve(strlen(print_prefix) + FIELD_SHORT_NAME_SIZE + 1);
+
+	out = put_str(out, print_prefix, strlen(print_prefix));
+	for (const char *c = field->desc->short_name; *c; c++)
+		*out++ = toupper(*c);
+	*out++ = '=';
+	out_commit(out);
+
+	if (field->desc->type == FIELD_RAW) {
+		print_bin(field);
+		return;
+	}
+
+	if (field->desc->type != FIELD_ASCII) {
+		field->ops->print_value(field);
+		return;
+	}
+
+	out = out_reserve(4 * size + 3);
+	if (shell)
+		out = put_ascii_shell(out, field->data, size);
+	else
+		out = put_ascii_udev(out, field->data, size);
+
+	*out++ = '\n';
+	out_commit(out);
+}
+
+static void print_shell(const struct field *field)
+{
+	print_property(field, true);
+}
+
+static void print_udev(const struct field *field)
 {
-	if (field->type != FIELD_RESERVED)
-		print_field(field, "%s=");
+	print_property(field, false);
 }
 
-#define OPS_UPDATABLE(type) { \
-	.get_data_size	= get_data_size, \
+static bool print_mac_array;
+
+/**
+ * print_json() - print the given field as a member of a JSON object
+ *
+ * The key is the short name of the field. Versions are numbers, MAC addresses
+ * are strings, or arrays of byte values if set by set_mac_array(), and other
+ * values are strings. Binary values are hexadecimal strings.
+ *
+ * Sample output: "mac1":"00:01:c0:13:91:d0"
+ *		  "major":1.20
+ *
+ * @field:	an initialized field to print
+ */
+static void print_json(const struct field *field)
+{
+	ASSERT(field && field->desc && field->data);
+
+	int size = field->desc->data_size;
+	char *out;
+
+	if (field->desc->type == FIELD_RESERVED)
+		return;
+
+	json_key(field->desc->short_name);
+	out = out_reserve(JSON_STRING_SIZE(size));
+	switch (field->desc->type) {
+	case FIELD_VERSION:
+		out = put_version(out, field->data);
+		break;
+	case FIELD_MAC:
+		if (print_mac_array) {
+			*out++ = '[';
+			for (int i = 0; i < size; i++) {
+				if (i)
+					*out++ = ',';
+				out = put_uint(out, field->data[i]);
+			}
+			*out++ = ']';
+		} else {
+			*out++ = '"';
+			out = put_hex_delim(out, field->data, size, ':');
+			*out++ = '"';
+		}
+		break;
+	case FIELD_DATE:
+		*out++ = '"';
+		out = put_date(out, field->data);
+		*out++ = '"';
+		break;
+	case FIELD_ASCII:
+		out = put_json_string(out, field->data,
+				      ascii_value_length(field->data, size));
+		break;
+	case FIELD_REVERSED:
+		*out++ = '"';
+		out = put_hex_rev(out, field->data, size);
+		*out++ = '"';
+		break;
+	case FIELD_CRC:
+		*out++ = '"';
+		out = put_hex_rev(out, field->data, 4);
+		*out++ = '"';
+		break;
+	default:
+		*out++ = '"';
+		out = put_hex(out, field->data, size);
+		*out++ = '"';
+		break;
+	}
+
+	out_commit(out);
+}
+
+/**
+ * print_binary() - print nothing for the given field
+ *
+ * The binary format prints a record of the entire image, described by
+ * record.h, rather than the fields.
+ *
+ * @field:	an initialized field
+ */
+static void print_binary(const struct field *field)
+{
+}
+
+/**
+ * set_mac_array() - set how MAC addresses are printed in the JSON format
+ *
+ * @mac_array:	true for arrays of byte values, false for strings
+ */
+void set_mac_array(bool mac_array)
+{
+	print_mac_array = mac_array;
+}
+
+const char *get_print_prefix(void)
+{
+	return print_prefix;
+}
+
+/**
+ * set_print_prefix() - set the prefix of the keys printed in the shell and
+ * udev formats
+ *
+ * @prefix:	the prefix, which must be usable in a shell variable name
+ */
+void set_print_prefix(const char *prefix)
+{
+	ASSERT(prefix);
+	print_prefix = prefix;
+}
+
+#define OPS_UPDATABLE(type, print_fn) { \
 	.is_named	= is_named, \
 	.print_value	= print_##type, \
-	.print		= print_default, \
+	.print		= print_fn, \
 	.update		= update_##type, \
 	.clear		= clear_field, \
 }
 
-#define OPS_PRINTABLE(type) { \
-	.get_data_size	= get_data_size, \
+#define OPS_PRINTABLE(type, print_fn) { \
 	.is_named	= is_named, \
 	.print_value	= print_##type, \
-	.print		= print_default, \
+	.print		= print_fn, \
 	.update		= NULL, \
 	.clear		= NULL, \
 }
 
-static struct field_ops field_ops[] = {
-	[FIELD_BINARY]		= OPS_UPDATABLE(bin),
-	[FIELD_REVERSED]	= OPS_UPDATABLE(bin_rev),
-	[FIELD_VERSION]		= OPS_UPDATABLE(bin_ver),
-	[FIELD_ASCII]		= OPS_UPDATABLE(ascii),
-	[FIELD_MAC]		= OPS_UPDATABLE(mac),
-	[FIELD_DATE]		= OPS_UPDATABLE(date),
-	[FIELD_RESERVED]	= OPS_PRINTABLE(reserved),
-	[FIELD_RAW]		= OPS_PRINTABLE(bin_raw)
+#define FORMAT_OPS(print_fn) { \
+	[FIELD_BINARY]		= OPS_UPDATABLE(bin, print_fn), \
+	[FIELD_REVERSED]	= OPS_UPDATABLE(bin_rev, print_fn), \
+	[FIELD_VERSION]		= OPS_UPDATABLE(bin_ver, print_fn), \
+	[FIELD_ASCII]		= OPS_UPDATABLE(ascii, print_fn), \
+	[FIELD_MAC]		= OPS_UPDATABLE(mac, print_fn), \
+	[FIELD_DATE]		= OPS_UPDATABLE(date, print_fn), \
+	[FIELD_RESERVED]	= OPS_PRINTABLE(reserved, print_fn), \
+	[FIELD_RAW]		= OPS_PRINTABLE(bin_raw, print_fn), \
+	[FIELD_CRC]		= OPS_UPDATABLE(crc, print_fn), \
+}
+
+static const struct field_ops field_ops[][FIELD_CRC + 1] = {
+	[FORMAT_DEFAULT]	= FORMAT_OPS(print_default),
+	[FORMAT_DUMP]		= FORMAT_OPS(print_dump),
+	[FORMAT_SHELL]		= FORMAT_OPS(print_shell),
+	[FORMAT_UDEV]		= FORMAT_OPS(print_udev),
+	[FORMAT_JSON]		= FORMAT_OPS(print_json),
+	[FORMAT_BINARY]		= FORMAT_OPS(print_binary),
 };
 
 /**
- * init_field() - init field according to field.type
+ * bind_field() - bind the description of a field to the data of an image
  *
- * @field:		an initialized field with a known field.type to init
- * @data:		the binary data of the field
+ * @desc:		the description of the field
+ * @image:		the image which holds the field
  * @print_format:	the print format of the field
+ *
+ * Returns: the field of the image.
  */
-void init_field(struct field *field, unsigned char *data,
-		enum print_format print_format)
+struct field bind_field(const struct field_desc *desc, unsigned char *image,
+			enum print_format print_format)
 {
-	ASSERT(field && data);
-
-	field->ops = &field_ops[field->type];
-	field->data = data;
+	ASSERT(desc && image);
 
-	if (print_format == FORMAT_DUMP)
-		field->ops->print = print_dump;
+	return (struct field) {
+		.desc	= desc,
+		.data	= image + desc->offset,
+		.ops	= &field_ops[print_format][desc->type],
+	};
 }
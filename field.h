@@ -31,24 +31,46 @@ enum field_type {
 	FIELD_DATE,
 	FIELD_RESERVED,
 	FIELD_RAW,
+	FIELD_CRC,
 };
 
+#define DEFAULT_PRINT_PREFIX	"EEPROM_"
+
 enum print_format {
 	FORMAT_DEFAULT,
 	FORMAT_DUMP,
+	FORMAT_SHELL,
+	FORMAT_UDEV,
+	FORMAT_JSON,
+	FORMAT_BINARY,
 };
 
-struct field {
-	char *name;
-	char *short_name;
+#define FIELD_NAME_SIZE		40
+#define FIELD_SHORT_NAME_SIZE	16
+
+/*
+ * The read-only description of a field, shared by all images. It holds no
+ * pointers, so descriptors can be stored in files and used in place.
+ */
+struct field_desc {
+	char name[FIELD_NAME_SIZE];
+	char short_name[FIELD_SHORT_NAME_SIZE];
 	int data_size;
 	enum field_type type;
+	int offset;
+	/* FIELD_CRC: the first and last bytes covered by the checksum */
+	int span_start;
+	int span_end;
+};
+
+/* A field of a particular image: its description bound to the image data */
+struct field {
+	const struct field_desc *desc;
 	unsigned char *data;
-	struct field_ops *ops;
+	const struct field_ops *ops;
 };
 
 struct field_ops {
-	int (*get_data_size)(const struct field *field);
 	bool (*is_named)(const struct field *field, const char *str);
 	void (*print_value)(const struct field *field);
 	void (*print)(const struct field *field);
@@ -56,7 +78,10 @@ struct field_ops {
 	void (*clear)(struct field *field);
 };
 
-void init_field(struct field *field, unsigned char *data,
-		enum print_format print_format);
+struct field bind_field(const struct field_desc *desc, unsigned char *image,
+			enum print_format print_format);
+void set_print_prefix(const char *prefix);
+const char *get_print_prefix(void);
+void set_mac_array(bool mac_array);
 
 #endif
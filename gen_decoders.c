@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Generates the decoders of the built in layouts, described in decoder.h, to
+ * standard output. Built and run on the build host.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "common.h"
+#include "layout.h"
+#include "builtin_layouts.h"
+
+struct builtin_layout {
+	const char *version;
+	const char *name;
+	const struct field_desc *fields;
+	int num_of_fields;
+};
+
+#define BUILTIN_LAYOUT(version, fields) \
+	{ #version, #fields, fields, ARRAY_LEN(fields) }
+
+static const struct builtin_layout layouts[] = {
+	BUILTIN_LAYOUT(LAYOUT_LEGACY, layout_legacy),
+	BUILTIN_LAYOUT(LAYOUT_VER1, layout_v1),
+	BUILTIN_LAYOUT(LAYOUT_VER2, layout_v2),
+	BUILTIN_LAYOUT(LAYOUT_VER3, layout_v3),
+	BUILTIN_LAYOUT(LAYOUT_VER4, layout_v4),
+};
+
+static const char *format_names[][2] = {
+	[FORMAT_DEFAULT]	= { "FORMAT_DEFAULT", "default" },
+	[FORMAT_DUMP]		= { "FORMAT_DUMP", "dump" },
+	[FORMAT_SHELL]		= { "FORMAT_SHELL", "shell" },
+	[FORMAT_UDEV]		= { "FORMAT_UDEV", "udev" },
+};
+
+/* Constant output which wasn't emitted yet, so it's emitted as one string */
+static char literal[1024];
+static int literal_len;
+
+/* The largest output and number of prefixes of the generated decoder */
+static int output_size;
+static int num_prefixes;
+
+static void add_literal(const char *str)
+{
+	int len = strlen(str);
+
+	if (literal_len + len > sizeof(literal)) {
+		fprintf(stderr, "gen_decoders: constant output too long\n");
+		exit(1);
+	}
+
+	memcpy(literal + literal_len, str, len);
+	literal_len += len;
+	output_size += len;
+}
+
+static void flush_literal(void)
+{
+	if (!literal_len)
+		return;
+
+	printf("\tout = put_str(out, \"");
+	for (int i = 0; i < literal_len; i++) {
+		if (literal[i] == '\n')
+			printf("\\n");
+		else if (literal[i] == '"' || literal[i] == '\\')
+			printf("\\%c", literal[i]);
+		else
+			putchar(literal[i]);
+	}
+
+	printf("\", %d);\n", literal_len);
+	literal_len = 0;
+}
+
+static void gen_value(const struct field_desc *field,
+		      enum print_format format)
+{
+	int offset = field->offset, size = field->data_size;
+
+	flush_literal();
+	switch (field->type) {
+	case FIELD_BINARY:
+		printf("\tout = put_hex(out, data + %d, %d);\n", offset, size);
+		output_size += 2 * size;
+		break;
+	case FIELD_REVERSED:
+		printf("\tout = put_hex_rev(out, data + %d, %d);\n", offset, size);
+		output_size += 2 * size;
+		break;
+	case FIELD_MAC:
+		printf("\tout = put_hex_delim(out, data + %d, %d, ':');\n",
+		       offset, size);
+		output_size += 3 * size - 1;
+		break;
+	case FIELD_VERSION:
+		printf("\tout = put_version(out, data + %d);\n", offset);
+		output_size += sizeof("655.35");
+		break;
+	case FIELD_DATE:
+		printf("\tout = put_date(out, data + %d);\n", offset);
+		output_size += sizeof("255/BAD/65535");
+		break;
+	case FIELD_ASCII:
+		if (format == FORMAT_SHELL) {
+			printf("\tout = put_ascii_shell(out, data + %d, %d);\n",
+			       offset, size);
+			output_size += 4 * size + 2;
+		} else if (format == FORMAT_UDEV) {
+			printf("\tout = put_ascii_udev(out, data + %d, %d);\n",
+			       offset, size);
+			output_size += size;
+		} else {
+			printf("\tout = put_ascii(out, data + %d, %d);\n",
+			       offset, size);
+			output_size += size;
+		}
+		break;
+	default:
+		fprintf(stderr, "gen_decoders: field \"%s\" can't be decoded\n",
+			field->name);
+		exit(1);
+	}
+}
+
+static void gen_field(const struct field_desc *field,
+		      enum print_format format)
+{
+	char str[FIELD_NAME_SIZE + 32];
+	int i;
+
+	if (format != FORMAT_DEFAULT && field->type == FIELD_RESERVED)
+		return;
+
+	switch (format) {
+	case FORMAT_DEFAULT:
+		snprintf(str, sizeof(str), "%-30s", field->name);
+		add_literal(str);
+		if (field->type == FIELD_RESERVED) {
+			snprintf(str, sizeof(str), "(%d bytes)\n",
+				 field->data_size);
+			add_literal(str);
+			return;
+		}
+		break;
+	case FORMAT_DUMP:
+		snprintf(str, sizeof(str), "%s=", field->name);
+		add_literal(str);
+		break;
+	case FORMAT_SHELL:
+	case FORMAT_UDEV:
+		flush_literal();
+		printf("\tout = put_str(out, prefix, prefix_len);\n");
+		num_prefixes++;
+		for (i = 0; field->short_name[i]; i++)
+			str[i] = toupper(field->short_name[i]);
+
+		str[i++] = '=';
+		str[i] = '\0';
+		add_literal(str);
+		break;
+	default:
+		/* the other formats are only printed by the field ops */
+		break;
+	}
+
+	gen_value(field, format);
+	add_literal("\n");
+}
+
+static void gen_decoder(const struct builtin_layout *layout,
+			enum print_format format)
+{
+	printf("static char *decode_%s_%s(const unsigned char *data, char *out,\n"
+	       "\t\t\t\tconst char *prefix)\n{\n",
+	       layout->name, format_names[format][1]);
+	if (format == FORMAT_SHELL || format == FORMAT_UDEV)
+		printf("\tint prefix_len = strlen(prefix);\n\n");
+
+	output_size = 0;
+	num_prefixes = 0;
+	for (int i = 0; i < layout->num_of_fields; i++)
+		gen_field(&layout->fields[i], format);
+
+	flush_literal();
+	printf("\treturn out;\n}\n\n");
+}
+
+int main(void)
+{
+	int sizes[ARRAY_LEN(layouts)][ARRAY_LEN(format_names)];
+	int prefixes[ARRAY_LEN(layouts)][ARRAY_LEN(format_names)];
+
+	printf("/* Generated by gen_decoders.c from builtin_layouts.h. Do not edit. */\n\n"
+	       "#include \"common.h\"\n"
+	       "#include \"decoder.h\"\n\n");
+
+	for (int i = 0; i < ARRAY_LEN(layouts); i++) {
+		for (int j = 0; j < ARRAY_LEN(format_names); j++) {
+			gen_decoder(&layouts[i], j);
+			sizes[i][j] = output_size;
+			prefixes[i][j] = num_prefixes;
+		}
+	}
+
+	printf("static const struct decoder decoders[LAYOUT_CUSTOM][%d] = {\n",
+	       (int)ARRAY_LEN(format_names));
+	for (int i = 0; i < ARRAY_LEN(layouts); i++) {
+		printf("\t[%s] = {\n", layouts[i].version);
+		for (int j = 0; j < ARRAY_LEN(format_names); j++)
+			printf("\t\t[%s] = { decode_%s_%s, %d, %d },\n",
+			       format_names[j][0], layouts[i].name,
+			       format_names[j][1], sizes[i][j], prefixes[i][j]);
+		printf("\t},\n");
+	}
+	printf("};\n\n");
+
+	printf("const struct decoder *get_decoder(enum layout_version layout_version,\n"
+	       "\t\t\t\t  enum print_format print_format)\n"
+	       "{\n"
+	       "\tif ((int)layout_version < 0 ||\n"
+	       "\t    layout_version >= ARRAY_LEN(decoders) ||\n"
+	       "\t    (int)print_format < 0 ||\n"
+	       "\t    print_format >= ARRAY_LEN(decoders[0]) ||\n"
+	       "\t    !decoders[layout_version][print_format].decode)\n"
+	       "\t\treturn NULL;\n\n"
+	       "\treturn &decoders[layout_version][print_format];\n"
+	       "}\n");
+
+	return 0;
+}
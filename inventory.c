@@ -0,0 +1,756 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The inventory is a directory with two files:
+ * entries:	An array of struct inventory_entry. One entry for each MAC
+ *		address and serial number found in the ingested inputs.
+ * index:	A struct index_header followed by an open addressing hash table
+ *		of entry numbers, hashed by key type and key.
+ *
+ * Entries are inserted into the hash table by their order in the entries
+ * file, so the first match while probing is always the earliest entry with
+ * the same key. This allows finding all duplicates in one pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <libgen.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "common.h"
+#include "layout.h"
+#include "store.h"
+#include "inventory.h"
+
+#define ENTRIES_FILE		"entries"
+#define INDEX_FILE		"index"
+#define INDEX_MAGIC		"EEPI"
+#define INDEX_MAGIC_SIZE	4
+
+#define KEY_SIZE		12
+#define SOURCE_SIZE		64
+#define MAC_SIZE		6
+
+enum key_type {
+	KEY_MAC,
+	KEY_SN,
+};
+
+static const char *key_names[] = {
+	[KEY_MAC]	= "mac",
+	[KEY_SN]	= "sn",
+};
+
+struct inventory_entry {
+	unsigned char type;
+	unsigned char key_size;
+	unsigned char key[KEY_SIZE];
+	char source[SOURCE_SIZE];
+};
+
+struct index_header {
+	char magic[INDEX_MAGIC_SIZE];
+	unsigned int num_slots;		/* always a power of 2 */
+	unsigned int num_entries;
+};
+
+struct entry_array {
+	struct inventory_entry *entries;
+	int size;
+	int capacity;
+};
+
+/* A read only view of the inventory files */
+struct inventory {
+	struct inventory_entry *entries;
+	size_t entries_size;
+	struct index_header *index;
+	size_t index_size;
+	unsigned int *slots;
+};
+
+static unsigned int hash_key(unsigned char type, const unsigned char *key,
+			     int key_size)
+{
+	/* FNV-1a */
+	unsigned int hash = 2166136261u;
+
+	hash = (hash ^ type) * 16777619u;
+	for (int i = 0; i < key_size; i++)
+		hash = (hash ^ key[i]) * 16777619u;
+
+	return hash;
+}
+
+static bool same_key(const struct inventory_entry *a,
+		     const struct inventory_entry *b)
+{
+	return a->type == b->type && a->key_size == b->key_size &&
+	       !memcmp(a->key, b->key, a->key_size);
+}
+
+static void print_key(const struct inventory_entry *entry)
+{
+	printf("%s ", key_names[entry->type]);
+	for (int i = 0; i < entry->key_size; i++) {
+		if (entry->type == KEY_MAC && i > 0)
+			printf(":");
+		printf("%02x", entry->key[i]);
+	}
+}
+
+/*
+ * is_blank_key() - check if a key holds no value (all 0x00 or all 0xff)
+ */
+static bool is_blank_key(const unsigned char *key, int key_size)
+{
+	for (int i = 1; i < key_size; i++)
+		if (key[i] != key[0])
+			return false;
+
+	return key[0] == 0 || key[0] == 0xff;
+}
+
+/*
+ * new_entry() - append a zeroed entry to an entry array
+ *
+ * Returns: a pointer to the new entry, NULL on failure.
+ */
+static struct inventory_entry *new_entry(struct entry_array *array)
+{
+	ASSERT(array);
+
+	if (array->size == array->capacity) {
+		int capacity = array->capacity ? array->capacity * 2 : 64;
+		void *new_alloc = realloc(array->entries,
+					  capacity * sizeof(*array->entries));
+		if (!new_alloc) {
+			perror(STR_ENO_MEM);
+			return NULL;
+		}
+
+		array->entries = new_alloc;
+		array->capacity = capacity;
+	}
+
+	struct inventory_entry *entry = &array->entries[array->size++];
+	memset(entry, 0, sizeof(*entry));
+
+	return entry;
+}
+
+static int add_entry(struct entry_array *array, enum key_type type,
+		     const unsigned char *key, int key_size, const char *source)
+{
+	ASSERT(array && key && source);
+
+	if (key_size <= 0 || key_size > KEY_SIZE || is_blank_key(key, key_size))
+		return 0;
+
+	struct inventory_entry *entry = new_entry(array);
+	if (!entry)
+		return -ENOMEM;
+
+	entry->type = type;
+	entry->key_size = key_size;
+	memcpy(entry->key, key, key_size);
+	strncpy(entry->source, source, SOURCE_SIZE - 1);
+
+	return 0;
+}
+
+/*
+ * parse_key() - parse a hex string into key bytes
+ * @str:	The string, i.e. "01:02:03:04:05:06" for a MAC address or
+ *		"0102030405060708090a0b0c" for a serial number
+ * @type:	The type of the key. MAC bytes are delimited by ':'.
+ * @key:	Where to save the bytes. Must be at least KEY_SIZE bytes.
+ *
+ * Returns: the number of bytes parsed, -1 on syntax error.
+ */
+static int parse_key(const char *str, enum key_type type, unsigned char *key)
+{
+	ASSERT(str && key);
+
+	int size = 0;
+
+	while (*str && size < KEY_SIZE) {
+		char byte[3] = { str[0], str[1], 0 };
+		char *end;
+
+		if (!isxdigit(str[0]) || !isxdigit(str[1]))
+			return -1;
+
+		key[size++] = strtol(byte, &end, 16);
+		str += 2;
+
+		if (type == KEY_MAC && *str == ':' && size < MAC_SIZE)
+			str++;
+	}
+
+	if (*str || (type == KEY_MAC && size != MAC_SIZE))
+		return -1;
+
+	return size;
+}
+
+/*
+ * ingest_image() - add the MAC addresses and the serial number of a raw
+ * EEPROM image. The image is decoded using the auto detected layout.
+ */
+static int ingest_image(struct entry_array *array, unsigned char *buf,
+			const char *source)
+{
+	ASSERT(array && buf && source);
+
+	int ret = 0;
+	struct layout *layout = new_layout(buf, EEPROM_SIZE,
+					   LAYOUT_AUTODETECT, FORMAT_DEFAULT);
+	if (!layout) {
+		perror(STR_ENO_MEM);
+		return -ENOMEM;
+	}
+
+	for (int i = 0; i < layout->num_of_fields && !ret; i++) {
+		struct field field = layout_field(layout, i);
+		unsigned char key[KEY_SIZE];
+		int size = field.desc->data_size;
+
+		if (field.desc->type == FIELD_MAC) {
+			ret = add_entry(array, KEY_MAC, field.data, size,
+					source);
+		} else if (field.ops->is_named(&field, "sn") &&
+			   size <= KEY_SIZE) {
+			/* keep the key in the same order the serial is shown */
+			for (int j = 0; j < size; j++)
+				key[j] = field.desc->type == FIELD_REVERSED ?
+					 field.data[size - 1 - j] :
+					 field.data[j];
+
+			ret = add_entry(array, KEY_SN, key, size, source);
+		}
+	}
+
+	free_layout(layout);
+	return ret;
+}
+
+/*
+ * ingest_dump() - add the MAC addresses and the serial numbers found in the
+ * output of "read -f dump" or "read all -f dump".
+ */
+static int ingest_dump(struct entry_array *array, FILE *file,
+		       const char *name)
+{
+	ASSERT(array && file && name);
+
+	char line[256], source[SOURCE_SIZE];
+	int bus, addr;
+
+	strncpy(source, name, SOURCE_SIZE - 1);
+	source[SOURCE_SIZE - 1] = '\0';
+
+	while (fgets(line, sizeof(line), file)) {
+		unsigned char key[KEY_SIZE];
+		int size;
+
+		line[strcspn(line, "\r\n")] = '\0';
+
+		/* "read all" prefixes each device with its bus and address */
+		if (sscanf(line, "; On i2c-%d, address 0x%x:", &bus, &addr) == 2) {
+			snprintf(source, SOURCE_SIZE, "%s:i2c-%d/0x%02x",
+				 name, bus, addr);
+			continue;
+		}
+
+		char *value = strchr(line, '=');
+		if (!value)
+			continue;
+
+		*value++ = '\0';
+		if (strstr(line, "MAC") || !strncmp(line, "mac", 3)) {
+			size = parse_key(value, KEY_MAC, key);
+			if (size > 0 && add_entry(array, KEY_MAC, key, size,
+						  source))
+				return -ENOMEM;
+		} else if (!strcmp(line, "Serial Number") ||
+			   !strcmp(line, "sn")) {
+			size = parse_key(value, KEY_SN, key);
+			if (size > 0 && add_entry(array, KEY_SN, key, size,
+						  source))
+				return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * ingest_file() - add the entries found in a file. Files of exactly
+ * EEPROM_SIZE bytes are treated as raw images, other files as dump output.
+ * Entries are tagged with the base name of the file.
+ */
+static int ingest_file(struct entry_array *array, const char *path, off_t size)
+{
+	ASSERT(array && path);
+
+	char path_copy[PATH_MAX];
+	unsigned char buf[EEPROM_SIZE];
+	int ret;
+
+	strncpy(path_copy, path, PATH_MAX - 1);
+	path_copy[PATH_MAX - 1] = '\0';
+	char *name = basename(path_copy);
+
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		eprintf("Failed opening %s: %s (%d)\n", path,
+			strerror(errno), -errno);
+		return -1;
+	}
+
+	if (size == EEPROM_SIZE && fread(buf, 1, EEPROM_SIZE, file) ==
+	    EEPROM_SIZE)
+		ret = ingest_image(array, buf, name);
+	else
+		ret = ingest_dump(array, file, name);
+
+	fclose(file);
+	return ret;
+}
+
+/*
+ * ingest_path() - add the entries of a file, or of every file in a directory
+ * @array:	Where to add the entries
+ * @path:	The file or directory
+ * @names:	Where to add the base names of the ingested files
+ */
+static int ingest_path(struct entry_array *array, const char *path,
+		       struct entry_array *names)
+{
+	ASSERT(array && path && names);
+
+	char sub_path[PATH_MAX];
+	char path_copy[PATH_MAX];
+	struct stat st;
+	int ret = 0;
+
+	if (stat(path, &st) < 0) {
+		eprintf("Failed accessing %s: %s (%d)\n", path,
+			strerror(errno), -errno);
+		return -1;
+	}
+
+	if (S_ISREG(st.st_mode)) {
+		strncpy(path_copy, path, PATH_MAX - 1);
+		path_copy[PATH_MAX - 1] = '\0';
+
+		/* names are kept as entries with an empty key */
+		struct inventory_entry *name = new_entry(names);
+		if (!name)
+			return -ENOMEM;
+
+		strncpy(name->source, basename(path_copy), SOURCE_SIZE - 1);
+
+		return ingest_file(array, path, st.st_size);
+	}
+
+	if (!S_ISDIR(st.st_mode))
+		return 0;
+
+	DIR *dir = opendir(path);
+	if (!dir) {
+		eprintf("Failed opening %s: %s (%d)\n", path,
+			strerror(errno), -errno);
+		return -1;
+	}
+
+	struct dirent *dirent;
+	while (!ret && (dirent = readdir(dir))) {
+		if (dirent->d_name[0] == '.')
+			continue;
+
+		snprintf(sub_path, PATH_MAX, "%s/%s", path, dirent->d_name);
+		ret = ingest_path(array, sub_path, names);
+	}
+
+	closedir(dir);
+	return ret;
+}
+
+static int compare_sources(const void *a, const void *b)
+{
+	return strcmp(((const struct inventory_entry *)a)->source,
+		      ((const struct inventory_entry *)b)->source);
+}
+
+/*
+ * is_replaced() - check if an old entry came from one of the files which were
+ * ingested again. names must be sorted by source.
+ */
+static bool is_replaced(const struct inventory_entry *entry,
+			const struct entry_array *names)
+{
+	struct inventory_entry base;
+
+	memset(&base, 0, sizeof(base));
+	strncpy(base.source, entry->source, SOURCE_SIZE - 1);
+	base.source[strcspn(base.source, ":")] = '\0';
+
+	return bsearch(&base, names->entries, names->size,
+		       sizeof(*names->entries), compare_sources) != NULL;
+}
+
+static void *map_file(const char *dir, const char *name, size_t *size)
+{
+	char path[PATH_MAX];
+	struct stat st;
+	void *map = NULL;
+
+	snprintf(path, PATH_MAX, "%s/%s", dir, name);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+			map = NULL;
+		else
+			*size = st.st_size;
+	}
+
+	close(fd);
+	return map;
+}
+
+static void close_inventory(struct inventory *inv)
+{
+	if (inv->entries)
+		munmap(inv->entries, inv->entries_size);
+	if (inv->index)
+		munmap(inv->index, inv->index_size);
+}
+
+/*
+ * valid_slots() - check that the hash table of the index can be probed: it
+ * has a power of 2 slots, at least one of them empty, and every other slot
+ * holds the number of an entry.
+ */
+static bool valid_slots(const struct index_header *header,
+			const unsigned int *slots)
+{
+	unsigned int num_slots = header->num_slots;
+	bool empty = false;
+
+	if (!num_slots || (num_slots & (num_slots - 1)))
+		return false;
+
+	for (unsigned int i = 0; i < num_slots; i++) {
+		if (slots[i] > header->num_entries)
+			return false;
+		if (!slots[i])
+			empty = true;
+	}
+
+	return empty;
+}
+
+/*
+ * valid_entries() - check that the entries can be compared and printed: each
+ * one has a known key type, a key size within its key, and a NUL-terminated
+ * source.
+ */
+static bool valid_entries(const struct inventory_entry *entries,
+			  unsigned int num_entries)
+{
+	for (unsigned int i = 0; i < num_entries; i++) {
+		const struct inventory_entry *entry = &entries[i];
+
+		if (entry->type > KEY_SN || !entry->key_size ||
+		    entry->key_size > KEY_SIZE ||
+		    !memchr(entry->source, '\0', SOURCE_SIZE))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * open_inventory() - map the inventory files and validate the index and the
+ * entries
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int open_inventory(const char *dir, struct inventory *inv)
+{
+	ASSERT(dir && inv);
+
+	memset(inv, 0, sizeof(*inv));
+	inv->index = map_file(dir, INDEX_FILE, &inv->index_size);
+	if (!inv->index) {
+		eprintf("Inventory error: No index found in %s\n", dir);
+		return -1;
+	}
+
+	struct index_header *header = inv->index;
+	inv->entries = map_file(dir, ENTRIES_FILE, &inv->entries_size);
+
+	if (inv->index_size < sizeof(*header) ||
+	    memcmp(header->magic, INDEX_MAGIC, INDEX_MAGIC_SIZE) ||
+	    inv->index_size != sizeof(*header) +
+			       header->num_slots * sizeof(unsigned int) ||
+	    inv->entries_size != header->num_entries * sizeof(*inv->entries) ||
+	    (header->num_entries && !inv->entries) ||
+	    !valid_slots(header, (unsigned int *)(header + 1)) ||
+	    !valid_entries(inv->entries, header->num_entries)) {
+		eprintf("Inventory error: The index in %s is corrupted\n", dir);
+		close_inventory(inv);
+		return -1;
+	}
+
+	inv->slots = (unsigned int *)(header + 1);
+	return 0;
+}
+
+/*
+ * first_match() - find the earliest entry with the same key as entry
+ *
+ * Returns: the entry number, or -1 if there's no such entry.
+ */
+static int first_match(const struct inventory *inv,
+		       const struct inventory_entry *entry)
+{
+	unsigned int mask = inv->index->num_slots - 1;
+	unsigned int i = hash_key(entry->type, entry->key, entry->key_size);
+
+	for (i &= mask; inv->slots[i]; i = (i + 1) & mask) {
+		int entry_num = inv->slots[i] - 1;
+		if (same_key(&inv->entries[entry_num], entry))
+			return entry_num;
+	}
+
+	return -1;
+}
+
+static int write_inventory(const char *dir, struct entry_array *array)
+{
+	ASSERT(dir && array);
+
+	char path[PATH_MAX];
+	struct index_header header = {
+		.magic		= INDEX_MAGIC,
+		.num_slots	= 16,
+		.num_entries	= array->size,
+	};
+
+	/* keep the load factor at or below 1/2 */
+	while (header.num_slots < 2 * array->size)
+		header.num_slots *= 2;
+
+	unsigned int mask = header.num_slots - 1;
+	unsigned int *slots = calloc(header.num_slots, sizeof(unsigned int));
+	if (!slots) {
+		perror(STR_ENO_MEM);
+		return -ENOMEM;
+	}
+
+	for (int j = 0; j < array->size; j++) {
+		struct inventory_entry *entry = &array->entries[j];
+		unsigned int i = hash_key(entry->type, entry->key,
+					  entry->key_size);
+
+		for (i &= mask; slots[i]; i = (i + 1) & mask)
+			;
+		slots[i] = j + 1;
+	}
+
+	int ret = -1;
+	if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+		goto done;
+
+	/* entries first, so a failure leaves an index which won't validate */
+	snprintf(path, PATH_MAX, "%s/" ENTRIES_FILE, dir);
+	if (write_file_atomic(path, NULL, 0, array->entries,
+			      array->size * sizeof(*array->entries)) < 0)
+		goto done;
+
+	snprintf(path, PATH_MAX, "%s/" INDEX_FILE, dir);
+	if (write_file_atomic(path, &header, sizeof(header), slots,
+			      header.num_slots * sizeof(unsigned int)) < 0)
+		goto done;
+
+	ret = 0;
+
+done:
+	if (ret)
+		eprintf("Failed writing inventory to %s: %s (%d)\n", dir,
+			strerror(errno), -errno);
+	free(slots);
+	return ret;
+}
+
+/*
+ * inventory_add() - ingest files into the inventory and rebuild its index
+ * @dir:	The inventory directory. Created if it doesn't exist.
+ * @files:	A list of files or directories of files to ingest.
+ *
+ * Entries which came from a file with the same base name as one of the
+ * ingested files are replaced.
+ *
+ * Returns: 0 on success, negative value on failure.
+ */
+int inventory_add(const char *dir, struct data_array *files)
+{
+	ASSERT(dir && files && files->fields_list);
+
+	struct entry_array array = { 0 }, new_entries = { 0 }, names = { 0 };
+	struct inventory inv;
+	int ret = 0;
+
+	for (int i = 0; i < files->size && !ret; i++)
+		ret = ingest_path(&new_entries, files->fields_list[i], &names);
+
+	if (ret)
+		goto done;
+
+	qsort(names.entries, names.size, sizeof(*names.entries),
+	      compare_sources);
+
+	/* keep the old entries, unless their source was ingested again */
+	if (access(dir, F_OK) == 0 && open_inventory(dir, &inv) == 0) {
+		int num_entries = inv.index->num_entries;
+		for (int i = 0; i < num_entries && !ret; i++) {
+			struct inventory_entry *entry = &inv.entries[i];
+			if (!is_replaced(entry, &names))
+				ret = add_entry(&array, entry->type, entry->key,
+						entry->key_size, entry->source);
+		}
+
+		close_inventory(&inv);
+	}
+
+	for (int i = 0; i < new_entries.size && !ret; i++) {
+		struct inventory_entry *entry = &new_entries.entries[i];
+		ret = add_entry(&array, entry->type, entry->key,
+				entry->key_size, entry->source);
+	}
+
+	if (!ret)
+		ret = write_inventory(dir, &array);
+
+done:
+	free(array.entries);
+	free(new_entries.entries);
+	free(names.entries);
+	return ret;
+}
+
+/*
+ * inventory_find() - print the sources of all entries with the given key
+ * @dir:	The inventory directory
+ * @query:	Two strings: the key type ("mac" or "sn") and the key
+ *
+ * Returns: 0 if found, -1 if not found or on failure.
+ */
+int inventory_find(const char *dir, struct data_array *query)
+{
+	ASSERT(dir && query && query->fields_list);
+
+	struct inventory_entry key = { 0 };
+	struct inventory inv;
+	int size, found = 0;
+
+	if (query->size != 2) {
+		ieprintf("Expected a key type and a key");
+		return -1;
+	}
+
+	if (!strcmp(query->fields_list[0], key_names[KEY_MAC])) {
+		key.type = KEY_MAC;
+	} else if (!strcmp(query->fields_list[0], key_names[KEY_SN])) {
+		key.type = KEY_SN;
+	} else {
+		ieprintf("Unknown key type \"%s\"", query->fields_list[0]);
+		return -1;
+	}
+
+	size = parse_key(query->fields_list[1], key.type, key.key);
+	if (size <= 0) {
+		ieprintf("Invalid %s \"%s\"", query->fields_list[0],
+			 query->fields_list[1]);
+		return -1;
+	}
+
+	key.key_size = size;
+	if (open_inventory(dir, &inv))
+		return -1;
+
+	unsigned int mask = inv.index->num_slots - 1;
+	unsigned int i = hash_key(key.type, key.key, key.key_size);
+	for (i &= mask; inv.slots[i]; i = (i + 1) & mask) {
+		struct inventory_entry *entry = &inv.entries[inv.slots[i] - 1];
+		if (same_key(entry, &key)) {
+			printf("%s\n", entry->source);
+			found++;
+		}
+	}
+
+	close_inventory(&inv);
+	return found ? 0 : -1;
+}
+
+/*
+ * inventory_dups() - print every MAC address and serial number which appears
+ * in more than one entry, along with the sources of both entries.
+ *
+ * Returns: 0 if there are no duplicates, -1 if there are or on failure.
+ */
+int inventory_dups(const char *dir)
+{
+	ASSERT(dir);
+
+	struct inventory inv;
+	int dups = 0;
+
+	if (open_inventory(dir, &inv))
+		return -1;
+
+	int num_entries = inv.index->num_entries;
+	for (int i = 0; i < num_entries; i++) {
+		int first = first_match(&inv, &inv.entries[i]);
+		if (first == i)
+			continue;
+
+		print_key(&inv.entries[i]);
+		printf(": %s, %s\n", inv.entries[first].source,
+		       inv.entries[i].source);
+		dups++;
+	}
+
+	close_inventory(&inv);
+	return dups ? -1 : 0;
+}
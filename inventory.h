@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _INVENTORY_
+#define _INVENTORY_
+
+#include "common.h"
+
+#define DEFAULT_INVENTORY_DIR	"/var/lib/eeprom-util/inventory"
+
+int inventory_add(const char *dir, struct data_array *files);
+int inventory_find(const char *dir, struct data_array *query);
+int inventory_dups(const char *dir);
+
+#endif
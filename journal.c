@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include "common.h"
+#include "store.h"
+#include "journal.h"
+
+#define JOURNAL_MAGIC	"EEPJ"
+#define NUM_PAGES	(EEPROM_SIZE / EEPROM_PAGE_SIZE)
+
+static bool page_pending(const struct journal *journal, int page)
+{
+	return journal->header.pending & (1 << page);
+}
+
+/*
+ * journal_begin() - record a write before making it
+ * @journal:	Where to save the journal
+ * @dir:	The journal directory. Created if it doesn't exist.
+ * @i2c_bus:	The bus of the device
+ * @i2c_addr:	The address of the device
+ * @old_image:	The contents of the device before the write
+ * @new_image:	The contents of the device after the write
+ *
+ * The pages which differ between the images are marked as pending. The
+ * journal reaches the disk before this returns, replacing the journal of
+ * the previous write to the device.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int journal_begin(struct journal *journal, const char *dir, int i2c_bus,
+		  int i2c_addr, const unsigned char *old_image,
+		  const unsigned char *new_image)
+{
+	ASSERT(journal && dir && old_image && new_image);
+
+	char path[PATH_MAX];
+	unsigned char images[2 * EEPROM_SIZE];
+
+	memcpy(journal->header.magic, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+	journal->header.image_size = EEPROM_SIZE;
+	journal->header.pending = 0;
+	for (int i = 0; i < NUM_PAGES; i++)
+		if (memcmp(old_image + i * EEPROM_PAGE_SIZE,
+			   new_image + i * EEPROM_PAGE_SIZE, EEPROM_PAGE_SIZE))
+			journal->header.pending |= 1 << i;
+
+	memcpy(journal->old_image, old_image, EEPROM_SIZE);
+	memcpy(journal->new_image, new_image, EEPROM_SIZE);
+	memcpy(images, old_image, EEPROM_SIZE);
+	memcpy(images + EEPROM_SIZE, new_image, EEPROM_SIZE);
+
+	store_path(path, dir, i2c_bus, i2c_addr);
+	if (make_dirs(dir) < 0 ||
+	    write_file_atomic(path, &journal->header, sizeof(journal->header),
+			      images, sizeof(images)) < 0)
+		goto error;
+
+	journal->fd = open(path, O_WRONLY);
+	if (journal->fd < 0)
+		goto error;
+
+	return 0;
+
+error:
+	eprintf("Failed writing the journal in %s: %s (%d)\n", dir,
+		strerror(errno), -errno);
+	return -1;
+}
+
+/*
+ * journal_load() - load the journal of the last write to a device
+ * @journal:	Where to save the journal
+ * @dir:	The journal directory
+ * @i2c_bus:	The bus of the device
+ * @i2c_addr:	The address of the device
+ *
+ * Returns: 0 on success, -1 if there's no valid journal.
+ */
+int journal_load(struct journal *journal, const char *dir, int i2c_bus,
+		 int i2c_addr)
+{
+	ASSERT(journal && dir);
+
+	char path[PATH_MAX];
+
+	store_path(path, dir, i2c_bus, i2c_addr);
+	journal->fd = open(path, O_RDWR);
+	if (journal->fd < 0)
+		return -1;
+
+	int fd = journal->fd;
+	if (read_all(fd, &journal->header, sizeof(journal->header)) == 0 &&
+	    read_all(fd, journal->old_image, EEPROM_SIZE) == 0 &&
+	    read_all(fd, journal->new_image, EEPROM_SIZE) == 0 &&
+	    !memcmp(journal->header.magic, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) &&
+	    journal->header.image_size == EEPROM_SIZE)
+		return 0;
+
+	journal_close(journal);
+	return -1;
+}
+
+/*
+ * journal_next_pending() - find the next run of consecutive pending pages
+ * @journal:	The journal
+ * @from:	The page aligned offset to search from
+ * @size:	Where to save the size of the run
+ *
+ * Returns: the offset of the run, or -1 if there are no more pending pages.
+ */
+int journal_next_pending(const struct journal *journal, int from, int *size)
+{
+	ASSERT(journal && size);
+
+	int page = from / EEPROM_PAGE_SIZE, end;
+
+	while (page < NUM_PAGES && !page_pending(journal, page))
+		page++;
+
+	if (page >= NUM_PAGES)
+		return -1;
+
+	for (end = page + 1; end < NUM_PAGES && page_pending(journal, end);
+	     end++)
+		;
+
+	*size = (end - page) * EEPROM_PAGE_SIZE;
+	return page * EEPROM_PAGE_SIZE;
+}
+
+/*
+ * journal_done() - record that pages were written
+ * @journal:	The journal
+ * @start:	The page aligned offset of the written pages
+ * @size:	The size of the written pages
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int journal_done(struct journal *journal, int start, int size)
+{
+	ASSERT(journal && journal->fd >= 0);
+
+	for (int i = start; i < start + size; i += EEPROM_PAGE_SIZE)
+		journal->header.pending &= ~(1 << (i / EEPROM_PAGE_SIZE));
+
+	if (pwrite(journal->fd, &journal->header.pending,
+		   sizeof(journal->header.pending),
+		   offsetof(struct journal_header, pending)) < 0 ||
+	    fdatasync(journal->fd) < 0) {
+		eprintf("Failed updating the journal: %s (%d)\n",
+			strerror(errno), -errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+void journal_close(struct journal *journal)
+{
+	ASSERT(journal);
+
+	if (journal->fd >= 0)
+		close(journal->fd);
+
+	journal->fd = -1;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _JOURNAL_
+#define _JOURNAL_
+
+#include "layout.h"
+
+#define DEFAULT_JOURNAL_DIR	"/var/lib/eeprom-util/journal"
+
+#define JOURNAL_MAGIC_SIZE	4
+
+struct journal_header {
+	char magic[JOURNAL_MAGIC_SIZE];
+	unsigned short image_size;
+	unsigned short pending;		/* one bit per page */
+};
+
+/*
+ * The journal of the last write to a device: the images before and after
+ * the write, and the pages which weren't written yet.
+ */
+struct journal {
+	int fd;
+	struct journal_header header;
+	unsigned char old_image[EEPROM_SIZE];
+	unsigned char new_image[EEPROM_SIZE];
+};
+
+int journal_begin(struct journal *journal, const char *dir, int i2c_bus,
+		  int i2c_addr, const unsigned char *old_image,
+		  const unsigned char *new_image);
+int journal_load(struct journal *journal, const char *dir, int i2c_bus,
+		 int i2c_addr);
+int journal_next_pending(const struct journal *journal, int from, int *size);
+int journal_done(struct journal *journal, int start, int size);
+void journal_close(struct journal *journal);
+
+#endif
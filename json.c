@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "common.h"
+#include "json.h"
+
+#define JSON_MAX_DEPTH	31
+
+/* the number of open objects, and a bit per open object with members */
+static int depth;
+static unsigned int has_members;
+
+void json_begin_object(void)
+{
+	ASSERT(depth < JSON_MAX_DEPTH);
+
+	out_str("{");
+	depth++;
+	has_members &= ~(1u << depth);
+}
+
+void json_end_object(void)
+{
+	ASSERT(depth > 0);
+
+	depth--;
+	out_str(depth ? "}" : "}\n");
+}
+
+/*
+ * json_key() - begin a member of the innermost open object
+ * @key:	The name of the member
+ */
+void json_key(const char *key)
+{
+	ASSERT(depth > 0 && key);
+
+	int len = strlen(key);
+	char *out = out_reserve(JSON_STRING_SIZE(len) + 2);
+
+	if (has_members & (1u << depth))
+		*out++ = ',';
+
+	has_members |= 1u << depth;
+	out = put_json_string(out, (const unsigned char *)key, len);
+	*out++ = ':';
+	out_commit(out);
+}
+
+void json_uint(unsigned int value)
+{
+	out_commit(put_uint(out_reserve(sizeof("4294967295")), value));
+}
+
+void json_string(const char *str)
+{
+	ASSERT(str);
+
+	int len = strlen(str);
+	out_commit(put_json_string(out_reserve(JSON_STRING_SIZE(len)),
+				   (const unsigned char *)str, len));
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _JSON_
+#define _JSON_
+
+#include "output.h"
+
+/*
+ * A streaming JSON writer, which renders into the output buffer as it goes.
+ * It only keeps the nesting of the open objects, to separate their members,
+ * so the output of any number of devices takes constant memory.
+ *
+ * A member is written by json_key() followed by exactly one value: an object,
+ * json_uint(), json_string(), or a value rendered with the put_json_*()
+ * helpers. A top level object ends its line.
+ */
+
+void json_begin_object(void);
+void json_end_object(void);
+void json_key(const char *key);
+void json_uint(unsigned int value);
+void json_string(const char *str);
+
+/* the largest output of put_json_string() */
+#define JSON_STRING_SIZE(len)	(6 * (len) + 2)
+
+/* a quoted string, with quotes, backslashes and non ASCII bytes escaped */
+static inline char *put_json_string(char *out, const unsigned char *str,
+				    int len)
+{
+	*out++ = '"';
+	for (int i = 0; i < len; i++) {
+		if (str[i] == '"' || str[i] == '\\') {
+			*out++ = '\\';
+			*out++ = str[i];
+		} else if (str[i] < 32 || str[i] >= 127) {
+			/* bytes past ASCII are taken as Latin-1 */
+			out = put_str(out, "\\u00", 4);
+			out = put_hex_byte(out, str[i]);
+		} else {
+			*out++ = str[i];
+		}
+	}
+
+	*out++ = '"';
+	return out;
+}
+
+#endif
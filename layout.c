@@ -25,175 +25,301 @@
 #include "layout.h"
 #include "common.h"
 #include "field.h"
+#include "builtin_layouts.h"
+#include "decoder.h"
+#include "crc.h"
+#include "output.h"
+#include "json.h"
 
-#define LAYOUT_CHECK_BYTE	44
 #define NO_LAYOUT_FIELDS	"Unknown layout. Dumping raw data\n"
-#define ARRAY_LEN(x)		(sizeof(x) / sizeof((x)[0]))
-
-struct field layout_legacy[5] = {
-	{ "MAC address",		"mac",	6,	FIELD_MAC },
-	{ "Board Revision",		"rev",	2,	FIELD_BINARY },
-	{ "Serial Number",		"sn",	8,	FIELD_BINARY },
-	{ "Board Configuration",	"conf",	64,	FIELD_ASCII },
-	{ "Reserved fields",		"rsvd",	176,	FIELD_RESERVED },
+
+static const struct field_desc layout_unknown[1] = {
+	{ NO_LAYOUT_FIELDS, "raw", 256, FIELD_RAW, 0 },
 };
 
-struct field layout_v1[12] = {
-	{ "Major Revision",	"major",	2,	FIELD_VERSION },
-	{ "Minor Revision",	"minor",	2,	FIELD_VERSION },
-	{ "1st MAC Address",	"mac1",		6,	FIELD_MAC },
-	{ "2nd MAC Address",	"mac2",		6,	FIELD_MAC },
-	{ "Production Date",	"date",		4,	FIELD_DATE },
-	{ "Serial Number",	"sn",		12,	FIELD_REVERSED },
-	{ "Reserved fields",	"rsvd",		96,	FIELD_RESERVED },
-	{ "Product Name",	"name",		16,	FIELD_ASCII },
-	{ "Product Options #1",	"opt1",		16,	FIELD_ASCII },
-	{ "Product Options #2",	"opt2",		16,	FIELD_ASCII },
-	{ "Product Options #3",	"opt3",		16,	FIELD_ASCII },
-	{ "Reserved fields",	"rsvd",		64,	FIELD_RESERVED },
+struct layout_desc {
+	const struct field_desc *fields;
+	int num_of_fields;
+	const struct name_index *names;
 };
 
-struct field layout_v2[15] = {
-	{ "Major Revision",			"major",	2,	FIELD_VERSION },
-	{ "Minor Revision",			"minor",	2,	FIELD_VERSION },
-	{ "1st MAC Address",			"mac1",		6,	FIELD_MAC },
-	{ "2nd MAC Address",			"mac2",		6,	FIELD_MAC },
-	{ "Production Date",			"date",		4,	FIELD_DATE },
-	{ "Serial Number",			"sn",		12,	FIELD_REVERSED },
-	{ "3rd MAC Address (WIFI)",		"mac3",		6,	FIELD_MAC },
-	{ "4th MAC Address (Bluetooth)",	"mac4",		6,	FIELD_MAC },
-	{ "Layout Version",			"layout",	1,	FIELD_BINARY },
-	{ "Reserved fields",			"rsvd",		83,	FIELD_RESERVED },
-	{ "Product Name",			"name", 	16,	FIELD_ASCII },
-	{ "Product Options #1",			"opt1", 	16,	FIELD_ASCII },
-	{ "Product Options #2",			"opt2", 	16,	FIELD_ASCII },
-	{ "Product Options #3",			"opt3", 	16,	FIELD_ASCII },
-	{ "Reserved fields",			"rsvd",		64,	FIELD_RESERVED },
+/* The name indexes of the built in layouts, built before main() */
+static struct name_index name_indexes[LAYOUT_CUSTOM];
+
+#define LAYOUT_DESC(version, fields) \
+	{ fields, ARRAY_LEN(fields), &name_indexes[version] }
+
+static const struct layout_desc layout_descs[] = {
+	[LAYOUT_LEGACY]	= LAYOUT_DESC(LAYOUT_LEGACY, layout_legacy),
+	[LAYOUT_VER1]	= LAYOUT_DESC(LAYOUT_VER1, layout_v1),
+	[LAYOUT_VER2]	= LAYOUT_DESC(LAYOUT_VER2, layout_v2),
+	[LAYOUT_VER3]	= LAYOUT_DESC(LAYOUT_VER3, layout_v3),
+	[LAYOUT_VER4]	= LAYOUT_DESC(LAYOUT_VER4, layout_v4),
 };
 
-struct field layout_v3[16] = {
-	{ "Major Revision",			"major",	2,	FIELD_VERSION },
-	{ "Minor Revision",			"minor",	2,	FIELD_VERSION },
-	{ "1st MAC Address",			"mac1",		6,	FIELD_MAC },
-	{ "2nd MAC Address",			"mac2",		6,	FIELD_MAC },
-	{ "Production Date",			"date",		4,	FIELD_DATE },
-	{ "Serial Number",			"sn",		12,	FIELD_REVERSED },
-	{ "3rd MAC Address (WIFI)",		"mac3",		6,	FIELD_MAC },
-	{ "4th MAC Address (Bluetooth)",	"mac4",		6,	FIELD_MAC },
-	{ "Layout Version",			"layout",	1,	FIELD_BINARY },
-	{ "CompuLab EEPROM ID",			"id",		3,	FIELD_BINARY },
-	{ "Reserved fields",			"rsvd",		80,	FIELD_RESERVED },
-	{ "Product Name",			"name",		16,	FIELD_ASCII },
-	{ "Product Options #1",			"opt1",		16,	FIELD_ASCII },
-	{ "Product Options #2",			"opt2",		16,	FIELD_ASCII },
-	{ "Product Options #3",			"opt3",		16,	FIELD_ASCII },
-	{ "Reserved fields",			"rsvd",		64,	FIELD_RESERVED },
+static const struct layout_desc unknown_desc = {
+	layout_unknown, ARRAY_LEN(layout_unknown), NULL
+};
+
+/* Custom layouts, registered by version. Unregistered entries have no fields */
+static struct layout_desc custom_descs[LAYOUT_UNRECOGNIZED];
+
+/*
+ * get_layout_desc() - get the descriptors of a layout version
+ *
+ * Returns: the descriptors, or NULL if the version is unknown.
+ */
+static const struct layout_desc *get_layout_desc(int layout_version)
+{
+	if (layout_version >= LAYOUT_LEGACY && layout_version < LAYOUT_CUSTOM)
+		return &layout_descs[layout_version];
+
+	if (layout_version >= LAYOUT_CUSTOM &&
+	    layout_version < LAYOUT_UNRECOGNIZED &&
+	    custom_descs[layout_version].fields)
+		return &custom_descs[layout_version];
+
+	return NULL;
+}
+
+/*
+ * Layouts are detected by signatures: checks of a few bytes of the image,
+ * each adding its score to a layout version when it holds. The version with
+ * the highest score wins, if it reaches DETECT_MIN_SCORE. The Layout Version
+ * byte decides on its own, unless it's blank or zero, which layout 1 images
+ * and short legacy board configurations share. Signatures only look at the
+ * first bytes of fields, so a device is detected by reading a few bytes.
+ */
+enum signature_type {
+	SIG_BYTE,	/* the byte is between min and max */
+	SIG_PROGRAMMED,	/* the bytes aren't blank */
+	SIG_ASCII,	/* the bytes begin a printable string */
+	SIG_DATE,	/* the bytes begin a valid production date */
 };
 
-struct field layout_v4[21] = {
-	{ "Major Revision",			"major",	2,	FIELD_VERSION },
-	{ "Minor Revision",			"minor",	2,	FIELD_VERSION },
-	{ "1st MAC Address",			"mac1",		6,	FIELD_MAC },
-	{ "2nd MAC Address",			"mac2",		6,	FIELD_MAC },
-	{ "Production Date",			"date",		4,	FIELD_DATE },
-	{ "Serial Number",			"sn",		12,	FIELD_REVERSED },
-	{ "3rd MAC Address (WIFI)",		"mac3",		6,	FIELD_MAC },
-	{ "4th MAC Address (Bluetooth)",	"mac4",		6,	FIELD_MAC },
-	{ "Layout Version",			"layout",	1,	FIELD_BINARY },
-	{ "CompuLab EEPROM ID",			"id",		3,	FIELD_BINARY },
-	{ "5th MAC Address",			"mac5",		6,	FIELD_MAC },
-	{ "6th MAC Address",			"mac6",		6,	FIELD_MAC },
-	{ "Scratchpad",				"spad",		4,	FIELD_BINARY },
-	{ "Reserved fields",			"rsvd",		64,	FIELD_RESERVED },
-	{ "Product Name",			"name",		16,	FIELD_ASCII },
-	{ "Product Options #1",			"opt1",		16,	FIELD_ASCII },
-	{ "Product Options #2",			"opt2",		16,	FIELD_ASCII },
-	{ "Product Options #3",			"opt3",		16,	FIELD_ASCII },
-	{ "Product Options #4",			"opt4",		16,	FIELD_ASCII },
-	{ "Product Options #5",			"opt5",		16,	FIELD_ASCII },
-	{ "Reserved fields",			"rsvd",		32,	FIELD_RESERVED },
+struct signature {
+	enum layout_version layout_version;
+	enum signature_type type;
+	int offset;
+	int size;
+	unsigned char min;
+	unsigned char max;
+	int score;
 };
 
-struct field layout_unknown[1] = {
-	{ NO_LAYOUT_FIELDS, "raw", 256, FIELD_RAW },
+#define DETECT_MIN_SCORE	4
+#define LAYOUT_BYTE_SCORE	8
+
+static const struct signature signatures[] = {
+	{ LAYOUT_LEGACY, SIG_BYTE,	 LAYOUT_CHECK_BYTE, 1, 0x20, 0xfe,
+	  LAYOUT_BYTE_SCORE },
+	{ LAYOUT_LEGACY, SIG_ASCII,	 16,  4, 0, 0, 6 },	/* conf */
+	{ LAYOUT_VER1,	 SIG_BYTE,	 LAYOUT_CHECK_BYTE, 1, 0, 0, 4 },
+	{ LAYOUT_VER1,	 SIG_BYTE,	 LAYOUT_CHECK_BYTE, 1, 0xff, 0xff, 4 },
+	{ LAYOUT_VER1,	 SIG_DATE,	 16,  2, 0, 0, 1 },
+	{ LAYOUT_VER1,	 SIG_ASCII,	 128, 4, 0, 0, 1 },	/* name */
+	{ LAYOUT_VER2,	 SIG_BYTE,	 LAYOUT_CHECK_BYTE, 1, 2, 2,
+	  LAYOUT_BYTE_SCORE },
+	{ LAYOUT_VER2,	 SIG_DATE,	 16,  2, 0, 0, 1 },
+	{ LAYOUT_VER2,	 SIG_ASCII,	 128, 4, 0, 0, 1 },
+	{ LAYOUT_VER3,	 SIG_BYTE,	 LAYOUT_CHECK_BYTE, 1, 3, 3,
+	  LAYOUT_BYTE_SCORE },
+	{ LAYOUT_VER3,	 SIG_PROGRAMMED, 45,  3, 0, 0, 1 },	/* id */
+	{ LAYOUT_VER3,	 SIG_DATE,	 16,  2, 0, 0, 1 },
+	{ LAYOUT_VER3,	 SIG_ASCII,	 128, 4, 0, 0, 1 },
+	{ LAYOUT_VER4,	 SIG_BYTE,	 LAYOUT_CHECK_BYTE, 1, 4, 4,
+	  LAYOUT_BYTE_SCORE },
+	{ LAYOUT_VER4,	 SIG_PROGRAMMED, 45,  3, 0, 0, 1 },	/* id */
+	{ LAYOUT_VER4,	 SIG_DATE,	 16,  2, 0, 0, 1 },
+	{ LAYOUT_VER4,	 SIG_ASCII,	 128, 4, 0, 0, 1 },
 };
 
+static bool is_printable(unsigned char c)
+{
+	return c >= 0x20 && c < 0x7f;
+}
+
+static bool signature_holds(const struct signature *sig,
+			    const unsigned char *data)
+{
+	int i;
+
+	switch (sig->type) {
+	case SIG_BYTE:
+		return data[sig->offset] >= sig->min &&
+		       data[sig->offset] <= sig->max;
+	case SIG_PROGRAMMED:
+		for (i = 0; i < sig->size; i++)
+			if (data[sig->offset + i] != 0xff)
+				return true;
+
+		return false;
+	case SIG_ASCII:
+		/* a string, possibly shorter than size, but not an empty one */
+		if (!is_printable(data[sig->offset]))
+			return false;
+
+		for (i = 1; i < sig->size && is_printable(data[sig->offset + i]);
+		     i++)
+			;
+
+		for (; i < sig->size; i++)
+			if (data[sig->offset + i] != 0 &&
+			    data[sig->offset + i] != 0xff)
+				return false;
+
+		return true;
+	case SIG_DATE:
+		return data[sig->offset] >= 1 && data[sig->offset] <= 31 &&
+		       data[sig->offset + 1] >= 1 && data[sig->offset + 1] <= 12;
+	}
+
+	return false;
+}
+
 /*
  * detect_layout() - detect layout based on the contents of the data.
- * @data: Pointer to the data to be analyzed.
+ * @data: Pointer to the data to be analyzed. Only the bytes marked by
+ *	  mark_detect_bytes() are looked at.
  *
- * Returns: the detected layout version.
+ * Returns: the detected layout version, or LAYOUT_UNRECOGNIZED.
  */
-static enum layout_version detect_layout(unsigned char *data)
+static enum layout_version detect_layout(const unsigned char *data)
 {
 	ASSERT(data);
 
-	switch (data[LAYOUT_CHECK_BYTE]) {
-	case 0xff:
-	case 0:
-		return LAYOUT_VER1;
-	case 2:
-		return LAYOUT_VER2;
-	case 3:
-		return LAYOUT_VER3;
-	case 4:
-		return LAYOUT_VER4;
+	int score[LAYOUT_UNRECOGNIZED] = { 0 };
+	int best = LAYOUT_UNRECOGNIZED, best_score = DETECT_MIN_SCORE - 1;
+	int layout_byte = data[LAYOUT_CHECK_BYTE];
+
+	for (int i = 0; i < ARRAY_LEN(signatures); i++)
+		if (signature_holds(&signatures[i], data))
+			score[signatures[i].layout_version] +=
+				signatures[i].score;
+
+	/* custom layouts are only known by their Layout Version byte */
+	if (layout_byte >= LAYOUT_CUSTOM && layout_byte < LAYOUT_UNRECOGNIZED &&
+	    get_layout_desc(layout_byte))
+		score[layout_byte] += LAYOUT_BYTE_SCORE;
+
+	for (int v = LAYOUT_LEGACY; v < LAYOUT_UNRECOGNIZED; v++) {
+		if (score[v] > best_score) {
+			best = v;
+			best_score = score[v];
+		}
 	}
 
-	if (data[LAYOUT_CHECK_BYTE] >= 0x20)
-		return LAYOUT_LEGACY;
+	return best;
+}
+
+/*
+ * mark_detect_bytes() - mark the bytes which layout detection looks at
+ * @mask:	EEPROM_SIZE flags, of which those of the bytes are set
+ *
+ * Reading only the marked bytes of a device is enough to detect its layout.
+ */
+void mark_detect_bytes(bool *mask)
+{
+	ASSERT(mask);
+
+	for (int i = 0; i < ARRAY_LEN(signatures); i++)
+		memset(mask + signatures[i].offset, true, signatures[i].size);
 
-	return LAYOUT_UNRECOGNIZED;
+	mask[LAYOUT_CHECK_BYTE] = true;
 }
 
 /*
- * build_layout() - Detect layout and build it with a predefined array
+ * build_layout() - Detect layout and bind its descriptors to the layout
  * @layout:	An allocated layout
  */
 static void build_layout(struct layout *layout)
 {
-	if (layout->layout_version == LAYOUT_AUTODETECT)
+	bool detected = layout->layout_version == LAYOUT_AUTODETECT;
+	if (detected)
 		layout->layout_version = detect_layout(layout->data);
 
-	switch (layout->layout_version) {
-	case LAYOUT_LEGACY:
-		layout->fields = layout_legacy;
-		layout->num_of_fields = ARRAY_LEN(layout_legacy);
-		break;
-	case LAYOUT_VER1:
-		layout->fields = layout_v1;
-		layout->num_of_fields = ARRAY_LEN(layout_v1);
-		break;
-	case LAYOUT_VER2:
-		layout->fields = layout_v2;
-		layout->num_of_fields = ARRAY_LEN(layout_v2);
-		break;
-	case LAYOUT_VER3:
-		layout->fields = layout_v3;
-		layout->num_of_fields = ARRAY_LEN(layout_v3);
-		break;
-	case LAYOUT_VER4:
-		layout->fields = layout_v4;
-		layout->num_of_fields = ARRAY_LEN(layout_v4);
-		break;
-	default:
-		layout->fields = layout_unknown;
-		layout->num_of_fields = ARRAY_LEN(layout_unknown);
+	const struct layout_desc *desc = get_layout_desc(layout->layout_version);
+	if (!desc) {
+		desc = &unknown_desc;
+		if (detected)
+			layout->layout_version = LAYOUT_UNRECOGNIZED;
 	}
+
+	layout->fields = desc->fields;
+	layout->num_of_fields = desc->num_of_fields;
+	layout->names = desc->names;
+}
+
+/*
+ * layout_field() - get a field of the image of a layout
+ * @layout:	An initialized layout
+ * @index:	The index of the field in the layout
+ *
+ * Returns: the field, bound to the image of the layout.
+ */
+struct field layout_field(const struct layout *layout, int index)
+{
+	ASSERT(layout && index >= 0 && index < layout->num_of_fields);
+
+	return bind_field(&layout->fields[index], layout->data,
+			  layout->print_format);
+}
+
+/*
+ * decode_layout() - print a built in layout through its generated decoder,
+ * which formats the entire image straight into the output buffer.
+ * @layout: A pointer to an existing struct layout.
+ *
+ * Returns: true if the layout was printed, false if it has no decoder.
+ */
+static bool decode_layout(const struct layout *layout)
+{
+	const struct decoder *decoder = get_decoder(layout->layout_version,
+						    layout->print_format);
+	if (!decoder)
+		return false;
+
+	const char *prefix = get_print_prefix();
+	int size = decoder->size + decoder->num_prefixes * strlen(prefix);
+	char *out = out_reserve(size);
+	if (!out)
+		return false;
+
+	char *end = decoder->decode(layout->data, out, prefix);
+	ASSERT(end - out <= size);
+	out_commit(end);
+
+	return true;
 }
 
 /*
  * print_layout() - print the layout and the data which is assigned to it.
  * @layout: A pointer to an existing struct layout.
+ *
+ * Built in layouts are printed by their decoders. The field ops print any
+ * other layout. Either way the output is written with a single write(). In
+ * the JSON format the fields are the members of one object.
  */
 static void print_layout(const struct layout *layout)
 {
 	ASSERT(layout && layout->fields);
 
-	struct field *fields = layout->fields;
+	bool json = layout->print_format == FORMAT_JSON;
+
+	if (json)
+		json_begin_object();
+
+	if (!decode_layout(layout)) {
+		for (int i = 0; i < layout->num_of_fields; i++) {
+			struct field field = layout_field(layout, i);
+			field.ops->print(&field);
+		}
+	}
 
-	for (int i = 0; i < layout->num_of_fields; i++)
-		fields[i].ops->print(&fields[i]);
+	if (json)
+		json_end_object();
+
+	out_flush();
 }
 
 /*
@@ -231,6 +357,176 @@ static size_t get_bytes_range(int offset_start, int offset_end)
 	return offset_end - offset_start + 1;
 }
 
+static uint32_t compute_crc(const struct field_desc *field,
+			    const unsigned char *image)
+{
+	return crc32c(image + field->span_start,
+		      field->span_end - field->span_start + 1);
+}
+
+static uint32_t stored_crc(const unsigned char *data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static bool is_blank(const unsigned char *data, int size)
+{
+	for (int i = 0; i < size; i++)
+		if (data[i] != 0xff)
+			return false;
+
+	return true;
+}
+
+/*
+ * update_crcs() - compute the checksum fields of an image
+ * @fields:		The fields of the layout of the image
+ * @num_of_fields:	The number of fields
+ * @image:		The image
+ *
+ * No checksum covers another one (see check_layout()), so their order
+ * doesn't matter.
+ */
+static void update_crcs(const struct field_desc *fields, int num_of_fields,
+			unsigned char *image)
+{
+	for (int i = 0; i < num_of_fields; i++) {
+		if (fields[i].type != FIELD_CRC)
+			continue;
+
+		uint32_t crc = compute_crc(&fields[i], image);
+		unsigned char *data = image + fields[i].offset;
+		data[0] = crc;
+		data[1] = crc >> 8;
+		data[2] = crc >> 16;
+		data[3] = crc >> 24;
+	}
+}
+
+/*
+ * check_crcs() - check the checksum fields of the image of a layout
+ * @layout:	An initialized layout
+ *
+ * A checksum which is blank along with all the bytes it covers is valid,
+ * since blank EEPROMs are.
+ *
+ * Returns: true if all the checksums are valid, false otherwise.
+ */
+static bool check_crcs(const struct layout *layout)
+{
+	ASSERT(layout && layout->fields);
+
+	bool valid = true;
+
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		const struct field_desc *field = &layout->fields[i];
+		if (field->type != FIELD_CRC)
+			continue;
+
+		const unsigned char *data = layout->data + field->offset;
+		uint32_t crc = compute_crc(field, layout->data);
+		if (stored_crc(data) == crc ||
+		    (is_blank(data, field->data_size) &&
+		     is_blank(layout->data + field->span_start,
+			      field->span_end - field->span_start + 1)))
+			continue;
+
+		eprintf("Checksum mismatch in \"%s\": stored %08x, computed %08x\n",
+			field->name, stored_crc(data), crc);
+		valid = false;
+	}
+
+	return valid;
+}
+
+/*
+ * next_unset() - find the first byte at or after a byte which no change set
+ * yet, compressing the path to it.
+ * @next:	For every byte, a byte at or before the next unset byte
+ * @i:		The byte to search from
+ */
+static int next_unset(int *next, int i)
+{
+	while (next[i] != i) {
+		next[i] = next[next[i]];
+		i = next[i];
+	}
+
+	return i;
+}
+
+/*
+ * coalesce_bytes() - normalize byte changes into sorted, disjoint runs
+ * @changes:	The changes, in the order they were given
+ * @num:	The number of changes
+ * @runs:	Where to save the runs, which are at most EEPROM_SIZE
+ *
+ * The last change of a byte wins. The changes are visited from the last, and
+ * each sets only the bytes which no later change set, skipping over the set
+ * ones, so every byte is set at most once. Adjacent bytes with the same value
+ * form a single run.
+ *
+ * Returns: the number of runs.
+ */
+static int coalesce_bytes(const struct bytes_change *changes, int num,
+			  struct bytes_change *runs)
+{
+	int value[EEPROM_SIZE];
+	int next[EEPROM_SIZE + 1];
+	int num_runs = 0;
+
+	for (int i = 0; i <= EEPROM_SIZE; i++)
+		next[i] = i;
+
+	for (int i = num - 1; i >= 0; i--) {
+		for (int b = next_unset(next, changes[i].start);
+		     b <= changes[i].end; b = next_unset(next, b)) {
+			value[b] = changes[i].value;
+			next[b] = b + 1;
+		}
+	}
+
+	for (int b = 0; b < EEPROM_SIZE; b++) {
+		if (next[b] == b)
+			continue;
+
+		if (num_runs && runs[num_runs - 1].end == b - 1 &&
+		    runs[num_runs - 1].value == value[b]) {
+			runs[num_runs - 1].end = b;
+			continue;
+		}
+
+		runs[num_runs++] = (struct bytes_change) { b, b, value[b] };
+	}
+
+	return num_runs;
+}
+
+/*
+ * apply_bytes() - apply byte changes to the image of a layout
+ * @layout:	An initialized layout
+ * @changes:	The checked changes
+ * @num:	The number of changes
+ *
+ * Returns: number of changed bytes.
+ */
+static int apply_bytes(struct layout *layout,
+		       const struct bytes_change *changes, int num)
+{
+	struct bytes_change runs[EEPROM_SIZE];
+	int num_runs = coalesce_bytes(changes, num, runs);
+	int changed_bytes = 0;
+
+	for (int i = 0; i < num_runs; i++) {
+		int size = runs[i].end - runs[i].start + 1;
+		memset(layout->data + runs[i].start, runs[i].value, size);
+		changed_bytes += size;
+	}
+
+	update_crcs(layout->fields, layout->num_of_fields, layout->data);
+	return changed_bytes;
+}
+
 /*
  * Selectively update EEPROM data by bytes.
  * @layout:	An initialized layout.
@@ -239,14 +535,14 @@ static size_t get_bytes_range(int offset_start, int offset_end)
  * 		end: The last byte in EEPROM to be written.
  * 		value: The value to be written to EEPROM.
  *
+ * Overlapping changes are applied as if in order.
+ *
  * Returns: number of updated bytes.
  */
 static int update_bytes(struct layout *layout, struct data_array *data)
 {
 	ASSERT(layout && data && data->bytes_changes);
 
-	int updated_bytes = 0;
-
 	for (int i = 0; i < data->size; i++) {
 		int offset_start = data->bytes_changes[i].start;
 		int offset_end = data->bytes_changes[i].end;
@@ -255,11 +551,8 @@ static int update_bytes(struct layout *layout, struct data_array *data)
 			return 0;
 
 		int value = data->bytes_changes[i].value;
-		if (value >= 0 && value <= 255){
-			memset(layout->data + offset_start, value, range);
-			updated_bytes += range;
+		if (value >= 0 && value <= 255)
 			continue;
-		}
 
 		char value_str[60];
 		int chars = sprintf(value_str, "'0x%02x' at offset ", value);
@@ -268,7 +561,7 @@ static int update_bytes(struct layout *layout, struct data_array *data)
 		return 0;
 	}
 
-	return updated_bytes;
+	return apply_bytes(layout, data->bytes_changes, data->size);
 }
 
 /*
@@ -284,48 +577,187 @@ static int clear_bytes(struct layout *layout, struct data_array *data)
 {
 	ASSERT(layout && data && data->bytes_list);
 
-	int cleared_bytes = 0;
+	struct bytes_change *changes = malloc(data->size * sizeof(*changes));
+	if (!changes) {
+		perror(STR_ENO_MEM);
+		return 0;
+	}
 
+	int cleared_bytes = 0;
 	for (int i = 0; i < data->size; i++) {
 		int offset_start = data->bytes_list[i].start;
 		int offset_end = data->bytes_list[i].end;
-		size_t range = get_bytes_range(offset_start, offset_end);
-		if (range == 0)
-			return 0;
+		if (get_bytes_range(offset_start, offset_end) == 0)
+			goto done;
 
-		memset(layout->data + offset_start, 0xff, range);
-		cleared_bytes += range;
+		changes[i] = (struct bytes_change) {
+			offset_start, offset_end, 0xff
+		};
 	}
 
+	cleared_bytes = apply_bytes(layout, changes, data->size);
+
+done:
+	free(changes);
 	return cleared_bytes;
 }
 
+static unsigned int hash_name(const char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+
+	return hash;
+}
+
+static const char *entry_name(const struct field_desc *fields,
+			      const struct name_entry *entry)
+{
+	const struct field_desc *field = &fields[entry->name / 2];
+
+	return entry->name % 2 ? field->short_name : field->name;
+}
+
+/* Returns: the entry of the name, or the empty entry where it belongs */
+static int name_slot(const struct field_desc *fields,
+		     const struct name_index *index, const char *name)
+{
+	unsigned int i = hash_name(name) & (NAME_INDEX_SIZE - 1);
+
+	while (index->entries[i].field != NAME_EMPTY &&
+	       strcmp(entry_name(fields, &index->entries[i]), name))
+		i = (i + 1) & (NAME_INDEX_SIZE - 1);
+
+	return i;
+}
+
+static void index_name(const struct field_desc *fields, struct name_index *index,
+		       int name, int field)
+{
+	const char *str = name % 2 ? fields[name / 2].short_name :
+				     fields[name / 2].name;
+	struct name_entry *entry = &index->entries[name_slot(fields, index, str)];
+
+	if (entry->field == NAME_EMPTY) {
+		entry->name = name;
+		entry->field = field;
+	} else if (entry->field != field) {
+		entry->field = NAME_AMBIGUOUS;
+	}
+}
+
+/*
+ * build_name_index() - index the names and short names of the fields of a
+ * layout
+ * @fields:		The fields of the layout
+ * @num_of_fields:	The number of fields, below NAME_INDEX_SIZE / 2
+ * @index:		Where to build the index
+ *
+ * The names of reserved fields, which repeat within a layout, are marked as
+ * reserved since those fields can't be operated on by name. Any other name
+ * held by more than one field is marked as ambiguous.
+ */
+void build_name_index(const struct field_desc *fields, int num_of_fields,
+		      struct name_index *index)
+{
+	ASSERT(fields && index && num_of_fields < NAME_INDEX_SIZE / 2);
+
+	for (int i = 0; i < NAME_INDEX_SIZE; i++)
+		index->entries[i].field = NAME_EMPTY;
+
+	for (int i = 0; i < num_of_fields; i++) {
+		int value = fields[i].type == FIELD_RESERVED ? NAME_RESERVED : i;
+
+		index_name(fields, index, 2 * i, value);
+		index_name(fields, index, 2 * i + 1, value);
+	}
+}
+
+static void __attribute__((constructor)) build_name_indexes(void)
+{
+	for (int v = LAYOUT_LEGACY; v < LAYOUT_CUSTOM; v++)
+		build_name_index(layout_descs[v].fields,
+				 layout_descs[v].num_of_fields,
+				 &name_indexes[v]);
+}
+
+/*
+ * register_layout() - add a custom layout
+ * @layout_version:	The version of the layout, which is also the value
+ *			of its Layout Version field
+ * @fields:		The fields of the layout, which must stay valid
+ * @num_of_fields:	The number of fields
+ * @index:		The name index of the fields, which must stay valid
+ *
+ * Returns: 0 on success, -1 if the version isn't free for a custom layout.
+ */
+int register_layout(enum layout_version layout_version,
+		    const struct field_desc *fields, int num_of_fields,
+		    const struct name_index *index)
+{
+	ASSERT(fields && index);
+
+	if (layout_version < LAYOUT_CUSTOM ||
+	    layout_version >= LAYOUT_UNRECOGNIZED ||
+	    custom_descs[layout_version].fields)
+		return -1;
+
+	custom_descs[layout_version] = (struct layout_desc) {
+		fields, num_of_fields, index
+	};
+
+	return 0;
+}
+
+/*
+ * lookup_field() - look up a field by its name or short name
+ *
+ * Returns: the index of the field, NAME_EMPTY if no field has the name,
+ * NAME_RESERVED if only reserved fields do, or NAME_AMBIGUOUS if more than one
+ * field does.
+ */
+static int lookup_field(const struct layout *layout, const char *field_name)
+{
+	int i = name_slot(layout->fields, layout->names, field_name);
+
+	return layout->names->entries[i].field;
+}
+
 /*
  * find_field() - Find a field by name from the layout data.
  * @layout:	An initialized layout
  * @field_name:	The name of the field to find
+ * @field:	Where to save the field
  *
- * Returns: A pointer to the field on success, NULL on failure.
+ * Returns: true on success, false on failure.
  */
-static struct field* find_field(struct layout *layout, char *field_name)
+static bool find_field(struct layout *layout, char *field_name,
+		       struct field *field)
 {
-	ASSERT(layout && layout->fields && field_name);
+	ASSERT(layout && layout->fields && field_name && field);
 
-	struct field *fields = layout->fields;
-
-	if (fields == layout_unknown) {
+	if (layout->fields == layout_unknown) {
 		eprintf("Layout error: Can't operate on fields. "
 			"The layout is unknown.\n");
-		return NULL;
+		return false;
 	}
 
-	for (int i = 0; i < layout->num_of_fields; i++)
-		if (fields[i].ops->is_named(&fields[i], field_name))
-			return &fields[i];
+	int i = lookup_field(layout, field_name);
+	if (i >= 0) {
+		*field = layout_field(layout, i);
+		return true;
+	}
 
-	ieprintf("Field \"%s\" not found", field_name);
+	if (i == NAME_AMBIGUOUS)
+		ieprintf("Field name \"%s\" is ambiguous", field_name);
+	else if (i == NAME_RESERVED)
+		ieprintf("Field \"%s\" is reserved", field_name);
+	else
+		ieprintf("Field \"%s\" not found", field_name);
 
-	return NULL;
+	return false;
 }
 
 /*
@@ -345,18 +777,19 @@ static int update_fields(struct layout *layout, struct data_array *data)
 		char *field_name = data->fields_changes[i].field;
 		char *field_value = data->fields_changes[i].value;
 
-		struct field *field = find_field(layout, field_name);
-		if (!field)
+		struct field field;
+		if (!find_field(layout, field_name, &field))
 			return 0;
 
 		if (*field_value == '\0')
-			field->ops->clear(field);
-		else if (field->ops->update(field, field_value))
+			field.ops->clear(&field);
+		else if (field.ops->update(&field, field_value))
 			return 0;
 
 		updated_fields_cnt++;
 	}
 
+	update_crcs(layout->fields, layout->num_of_fields, layout->data);
 	return updated_fields_cnt;
 }
 
@@ -374,17 +807,93 @@ static int clear_fields(struct layout *layout, struct data_array *data)
 	int cleared_fields_cnt = 0;
 
 	for (int i = 0; i < data->size; i++) {
-		struct field *field = find_field(layout, data->fields_list[i]);
-		if (!field)
+		struct field field;
+		if (!find_field(layout, data->fields_list[i], &field))
 			return 0;
 
-		field->ops->clear(field);
+		field.ops->clear(&field);
 		cleared_fields_cnt++;
 	}
 
+	update_crcs(layout->fields, layout->num_of_fields, layout->data);
 	return cleared_fields_cnt;
 }
 
+/*
+ * migrate_layout() - convert the image to another layout version in place
+ * @layout:	An initialized layout of version 1 to 4, or a custom layout
+ * @target:	The layout version to convert to, 1 to 4 or a custom layout
+ *
+ * Each field of the target layout takes the value of the field with the same
+ * short name in the source layout. Fields which are new in the target layout
+ * are cleared, except for the Layout Version field which is set. Reserved
+ * bytes keep their value only if they were reserved in the source as well.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+static int migrate_layout(struct layout *layout, enum layout_version target)
+{
+	ASSERT(layout && layout->fields);
+
+	unsigned char image[EEPROM_SIZE];
+	bool was_reserved[EEPROM_SIZE] = { false };
+	const struct layout_desc *dest = get_layout_desc(target);
+
+	if (layout->layout_version < LAYOUT_VER1 ||
+	    !get_layout_desc(layout->layout_version) ||
+	    target < LAYOUT_VER1 || !dest) {
+		ieprintf("Only layouts 1 to 4 and custom layouts can be migrated");
+		return -1;
+	}
+
+	if (layout->layout_version == target)
+		return 0;
+
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		const struct field_desc *field = &layout->fields[i];
+		if (field->type == FIELD_RESERVED)
+			memset(was_reserved + field->offset, true,
+			       field->data_size);
+	}
+
+	memcpy(image, layout->data, EEPROM_SIZE);
+	for (int i = 0; i < dest->num_of_fields; i++) {
+		const struct field_desc *field = &dest->fields[i];
+		unsigned char *data = image + field->offset;
+
+		if (field->type == FIELD_RESERVED) {
+			for (int j = 0; j < field->data_size; j++)
+				if (!was_reserved[field->offset + j])
+					data[j] = 0xff;
+			continue;
+		}
+
+		if (!strcmp(field->short_name, "layout")) {
+			data[0] = target;
+			continue;
+		}
+
+		int j = lookup_field(layout, field->short_name);
+		const struct field_desc *source = j >= 0 ?
+						  &layout->fields[j] : NULL;
+
+		if (!source) {
+			memset(data, 0xff, field->data_size);
+		} else if (source->type == field->type &&
+			   source->data_size == field->data_size) {
+			memcpy(data, layout->data + source->offset,
+			       field->data_size);
+		} else {
+			ieprintf("Field \"%s\" can't be migrated", field->name);
+			return -1;
+		}
+	}
+
+	update_crcs(dest->fields, dest->num_of_fields, image);
+	memcpy(layout->data, image, EEPROM_SIZE);
+	return 0;
+}
+
 /*
  * new_layout() - Allocate a new layout based on the data given in buf.
  * @buf:	Data seed for layout
@@ -407,22 +916,20 @@ struct layout *new_layout(unsigned char *buf, unsigned int buf_size,
 		return NULL;
 
 	layout->layout_version = layout_version;
+	layout->print_format = print_format;
 	layout->data = buf;
 	layout->data_size = buf_size;
 
 	build_layout(layout);
 
-	for (int i = 0; i < layout->num_of_fields; i++) {
-		struct field *field = &layout->fields[i];
-		init_field(field, buf, print_format);
-		buf += field->ops->get_data_size(field);
-	}
-
 	layout->print = print_layout;
 	layout->update_fields = update_fields;
 	layout->update_bytes = update_bytes;
 	layout->clear_fields = clear_fields;
 	layout->clear_bytes = clear_bytes;
+	layout->get_field = find_field;
+	layout->migrate = migrate_layout;
+	layout->check_crcs = check_crcs;
 
 	return layout;
 }
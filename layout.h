@@ -24,6 +24,10 @@
 #include "field.h"
 
 #define EEPROM_SIZE 256
+#define EEPROM_PAGE_SIZE 16
+
+/* The offset of the "Layout Version" field */
+#define LAYOUT_CHECK_BYTE 44
 
 enum layout_version {
 	LAYOUT_AUTODETECT = -1,
@@ -32,14 +36,44 @@ enum layout_version {
 	LAYOUT_VER2,
 	LAYOUT_VER3,
 	LAYOUT_VER4,
-	LAYOUT_UNRECOGNIZED, /* marks the end of the layout versions */
+	LAYOUT_CUSTOM,	/* the first version of custom layouts */
+	/* marks the end of the layout versions, which must be below 0x20 */
+	LAYOUT_UNRECOGNIZED = 0x20,
 	RAW_DATA,
 };
 
+/*
+ * The names and short names of the fields of a layout, indexed by an open
+ * addressing hash table. An entry holds the index of the field with the name,
+ * and where the name itself is found: the index of a field holding it, times
+ * two, plus one for a short name. The index holds no pointers, so it can be
+ * stored in files and used in place.
+ */
+#define NAME_INDEX_SIZE		256	/* a power of 2, over twice the names */
+#define NAME_EMPTY		-1
+#define NAME_AMBIGUOUS		-2
+#define NAME_RESERVED		-3
+
+struct name_entry {
+	short field;
+	short name;
+};
+
+struct name_index {
+	struct name_entry entries[NAME_INDEX_SIZE];
+};
+
+/*
+ * A layout binds the read-only field descriptors of a layout version to an
+ * image. Layouts don't share any state, so any number of them may exist at
+ * once.
+ */
 struct layout {
-	struct field *fields;
+	const struct field_desc *fields;
 	int num_of_fields;
 	enum layout_version layout_version;
+	enum print_format print_format;
+	const struct name_index *names;
 	unsigned char *data;
 	int data_size;
 	void (*print)(const struct layout *layout);
@@ -51,11 +85,22 @@ struct layout {
 			    struct data_array *data);
 	int (*clear_bytes)(struct layout *layout,
 			   struct data_array *data);
+	bool (*get_field)(struct layout *layout, char *field_name,
+			  struct field *field);
+	int (*migrate)(struct layout *layout, enum layout_version target);
+	bool (*check_crcs)(const struct layout *layout);
 };
 
 struct layout *new_layout(unsigned char *buf, unsigned int buf_size,
 			  enum layout_version layout_version,
 			  enum print_format print_format);
 void free_layout(struct layout *layout);
+struct field layout_field(const struct layout *layout, int index);
+void mark_detect_bytes(bool *mask);
+void build_name_index(const struct field_desc *fields, int num_of_fields,
+		      struct name_index *index);
+int register_layout(enum layout_version layout_version,
+		    const struct field_desc *fields, int num_of_fields,
+		    const struct name_index *index);
 
 #endif
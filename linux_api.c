@@ -78,7 +78,7 @@ static int i2c_read(struct api *api, unsigned char *buf, int offset, int size)
 	int bytes_transferred = 0;
 	union i2c_smbus_data data;
 
-	for (int i = offset; i < size; i++) {
+	for (int i = offset; i < offset + size; i++) {
 		if (i2c_smbus_access(api->fd, I2C_SMBUS_READ, i,
 				I2C_SMBUS_BYTE_DATA, &data) < 0)
 			return -1;
@@ -90,6 +90,40 @@ static int i2c_read(struct api *api, unsigned char *buf, int offset, int size)
 	return bytes_transferred;
 }
 
+/*
+ * Read in chunks of up to I2C_SMBUS_BLOCK_MAX bytes per transaction instead of
+ * one byte per transaction. Only used if the adapter supports it.
+ */
+static int i2c_block_read(struct api *api, unsigned char *buf, int offset,
+			  int size)
+{
+	ASSERT(api && buf);
+
+	int bytes_transferred = 0;
+	union i2c_smbus_data data;
+
+	while (bytes_transferred < size) {
+		int len = size - bytes_transferred;
+		if (len > I2C_SMBUS_BLOCK_MAX)
+			len = I2C_SMBUS_BLOCK_MAX;
+
+		data.block[0] = len;
+		if (i2c_smbus_access(api->fd, I2C_SMBUS_READ,
+				offset + bytes_transferred,
+				I2C_SMBUS_I2C_BLOCK_DATA, &data) < 0)
+			return -1;
+
+		if (data.block[0] == 0 || data.block[0] > len)
+			return -1;
+
+		memcpy(buf + offset + bytes_transferred, &data.block[1],
+		       data.block[0]);
+		bytes_transferred += data.block[0];
+	}
+
+	return bytes_transferred;
+}
+
 /*
  * This function supplies the appropriate delay needed for consecutive writes
  * via i2c to succeed
@@ -107,7 +141,7 @@ static int i2c_write(struct api *api, unsigned char *buf, int offset, int size)
 	int bytes_transferred = 0;
 	union i2c_smbus_data data;
 
-	for (int i = offset; i < size; i++) {
+	for (int i = offset; i < offset + size; i++) {
 		data.byte = buf[i];
 		if (i2c_smbus_access(api->fd, I2C_SMBUS_WRITE, i,
 				I2C_SMBUS_BYTE_DATA, &data) < 0)
@@ -136,6 +170,23 @@ static int driver_write(struct api *api, unsigned char *buf, int offset,
 	return write(api->fd, buf + offset, size);
 }
 
+/*
+ * Select the fastest read method the i2c adapter behind api->fd supports.
+ */
+static void set_i2c_ops(struct api *api)
+{
+	ASSERT(api);
+
+	unsigned long funcs = 0;
+
+	api->read = i2c_read;
+	api->write = i2c_write;
+
+	if (ioctl(api->fd, I2C_FUNCS, &funcs) == 0 &&
+	    (funcs & I2C_FUNC_SMBUS_READ_I2C_BLOCK))
+		api->read = i2c_block_read;
+}
+
 static bool i2c_probe(int fd, int addr)
 {
 	union i2c_smbus_data data;
@@ -261,6 +312,121 @@ static int list_accessible(struct api *api)
 	return -(ret1 && ret2); /* return -1 only if both fail */
 }
 
+/*
+ * Call found() for each EEPROM device found on the i2c-dev interface of the
+ * given bus. The bus is opened only once and every device found is accessed
+ * through the same file descriptor.
+ *
+ * Returns: the number of devices found, -1 if the bus can't be opened.
+ */
+static int scan_i2c_bus(struct api *api, int bus, eeprom_found_fn found,
+			void *ctx, int *errors)
+{
+	ASSERT(api && found && errors);
+
+	char dev_file_name[13];
+	int count = 0;
+
+	sprintf(dev_file_name, "/dev/i2c-%d", bus);
+	int fd = open(dev_file_name, O_RDWR);
+	if (fd < 0)
+		return -1;
+
+	for (int j = MIN_EEPROM_ADDR; j <= MAX_EEPROM_ADDR; j++) {
+		/* i2c_probe() leaves the device selected on success */
+		if (!i2c_probe(fd, j))
+			continue;
+
+		api->fd = fd;
+		api->i2c_bus = bus;
+		api->i2c_addr = j;
+		set_i2c_ops(api);
+		if (found(api, ctx) < 0)
+			(*errors)++;
+
+		count++;
+	}
+
+	close(fd);
+	api->fd = -1;
+
+	return count;
+}
+
+/*
+ * Call found() for each EEPROM device file of the given bus. Used on buses
+ * which aren't accessible via the i2c-dev interface.
+ *
+ * Returns: the number of devices found.
+ */
+static int scan_driver_bus(struct api *api, int bus, eeprom_found_fn found,
+			   void *ctx, int *errors)
+{
+	ASSERT(api && found && errors);
+
+	char dev_file_name[40];
+	int count = 0;
+
+	for (int j = MIN_EEPROM_ADDR; j <= MAX_EEPROM_ADDR; j++) {
+		sprintf(dev_file_name, DRIVER_DEV_PATH"/%d-00%02x/eeprom",
+			bus, j);
+		int fd = open_device_file(dev_file_name, -1);
+		if (fd < 0)
+			continue;
+
+		api->fd = fd;
+		api->i2c_bus = bus;
+		api->i2c_addr = j;
+		api->read = driver_read;
+		api->write = driver_write;
+		if (found(api, ctx) < 0)
+			(*errors)++;
+
+		close(fd);
+		api->fd = -1;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * scan_accessible() - call found() for every EEPROM device on the system, or
+ * only on api->i2c_bus if it isn't negative. Within found(), api is set up
+ * for accessing the found device.
+ *
+ * Returns: 0 if devices were found and found() succeeded for all of them,
+ * -1 otherwise.
+ */
+static int scan_accessible(struct api *api, eeprom_found_fn found, void *ctx)
+{
+	ASSERT(api && found);
+	ASSERT(api->i2c_bus <= MAX_I2C_BUS);
+
+	int count = 0, errors = 0;
+	int bus = api->i2c_bus;
+
+	int i = (bus < 0) ? MIN_I2C_BUS : bus;
+	int end = (bus < 0) ? MAX_I2C_BUS : bus;
+	for (; i <= end; i++) {
+		int res = scan_i2c_bus(api, i, found, ctx, &errors);
+		if (res < 0)
+			res = scan_driver_bus(api, i, found, ctx, &errors);
+
+		count += res;
+	}
+
+	api->i2c_bus = bus;
+
+	if (count == 0) {
+		PRINT_NOT_FOUND("EEPROM device");
+		PRINT_BUS_NUM(bus);
+		return -1;
+	}
+
+	return errors ? -1 : 0;
+}
+
 static void system_error(const char *message)
 {
 	perror(message);
@@ -279,8 +445,7 @@ static int setup_interface(struct api *api)
 	sprintf(i2cdev_fname, "/dev/i2c-%d", api->i2c_bus);
 	api->fd = open_device_file(i2cdev_fname, api->i2c_addr);
 	if (api->fd >= 0) {
-		api->read = i2c_read;
-		api->write = i2c_write;
+		set_i2c_ops(api);
 		return 0;
 	}
 
@@ -337,13 +502,28 @@ static int api_write_before_setup(struct api *api, unsigned char *buf,
 	return -1;
 }
 
+static void api_close(struct api *api)
+{
+	ASSERT(api);
+
+	if (api->fd >= 0)
+		close(api->fd);
+
+	api->fd = -1;
+	api->read = api_read_before_setup;
+	api->write = api_write_before_setup;
+}
+
 void api_init(struct api *api, int i2c_bus, int i2c_addr)
 {
+	api->fd = -1;
 	api->i2c_bus = i2c_bus;
 	api->i2c_addr = i2c_addr;
 
 	api->read = api_read_before_setup;
 	api->write = api_write_before_setup;
 	api->probe = list_accessible;
+	api->scan = scan_accessible;
+	api->close = api_close;
 	api->system_error = system_error;
 }
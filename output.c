@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "common.h"
+#include "output.h"
+
+/* reservations of up to this size never fail */
+#define OUT_MIN_SIZE	4096
+
+static char out_static[OUT_MIN_SIZE];
+static char *out_buf = out_static;
+static int out_len;
+static int out_size = OUT_MIN_SIZE;
+
+/*
+ * out_reserve() - reserve room at the end of the output buffer
+ * @size:	The largest output which will be committed
+ *
+ * The buffer grows as needed. If it can't, its contents are flushed to make
+ * room, so reservations of up to OUT_MIN_SIZE bytes always succeed.
+ *
+ * Returns: where to render the output, or NULL if there's no room for it.
+ */
+char *out_reserve(int size)
+{
+	ASSERT(size >= 0);
+
+	if (out_len + size <= out_size)
+		return out_buf + out_len;
+
+	int new_size = out_size;
+	while (new_size < out_len + size)
+		new_size *= 2;
+
+	char *buf = out_buf == out_static ? malloc(new_size) :
+					    realloc(out_buf, new_size);
+	if (buf) {
+		if (out_buf == out_static)
+			memcpy(buf, out_static, out_len);
+
+		out_buf = buf;
+		out_size = new_size;
+		return out_buf + out_len;
+	}
+
+	out_flush();
+	return size <= out_size ? out_buf : NULL;
+}
+
+/*
+ * out_commit() - append the output rendered into the last reservation
+ * @end:	The end of the output
+ */
+void out_commit(char *end)
+{
+	ASSERT(end >= out_buf + out_len && end <= out_buf + out_size);
+
+	out_len = end - out_buf;
+}
+
+void out_str(const char *str)
+{
+	ASSERT(str);
+
+	int len = strlen(str);
+	out_commit(put_str(out_reserve(len), str, len));
+}
+
+/*
+ * out_flush() - write the output buffer to standard output
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int out_flush(void)
+{
+	int done = 0, ret = 0;
+
+	fflush(stdout);
+	while (done < out_len) {
+		ssize_t n = write(STDOUT_FILENO, out_buf + done, out_len - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n < 0) {
+			ret = -1;
+			break;
+		}
+
+		done += n;
+	}
+
+	out_len = 0;
+	return ret;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OUTPUT_
+#define _OUTPUT_
+
+#include <string.h>
+
+/*
+ * Printed values are rendered into one growable output buffer, which is
+ * written to standard output with a single write() by out_flush(). Anything
+ * printed to stdout with stdio is flushed first, so the output stays in order.
+ *
+ * To render, reserve room for the longest output, render it with the put_*()
+ * helpers, each of which returns the end of its output, and commit the end:
+ *
+ *	char *out = out_reserve(2 * size + 1);
+ *	out = put_hex(out, data, size);
+ *	*out++ = '\n';
+ *	out_commit(out);
+ */
+
+char *out_reserve(int size);
+void out_commit(char *end);
+void out_str(const char *str);
+int out_flush(void);
+
+static inline char *put_str(char *out, const char *str, int len)
+{
+	memcpy(out, str, len);
+	return out + len;
+}
+
+static inline char *put_hex_byte(char *out, unsigned char byte)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	out[0] = digits[byte >> 4];
+	out[1] = digits[byte & 0xf];
+	return out + 2;
+}
+
+static inline char *put_hex(char *out, const unsigned char *data, int size)
+{
+	for (int i = 0; i < size; i++)
+		out = put_hex_byte(out, data[i]);
+
+	return out;
+}
+
+static inline char *put_hex_rev(char *out, const unsigned char *data, int size)
+{
+	for (int i = size - 1; i >= 0; i--)
+		out = put_hex_byte(out, data[i]);
+
+	return out;
+}
+
+static inline char *put_hex_delim(char *out, const unsigned char *data,
+				  int size, char delimiter)
+{
+	out = put_hex_byte(out, data[0]);
+	for (int i = 1; i < size; i++) {
+		*out++ = delimiter;
+		out = put_hex_byte(out, data[i]);
+	}
+
+	return out;
+}
+
+static inline char *put_uint(char *out, unsigned int value)
+{
+	char digits[10];
+	int i = 0;
+
+	do {
+		digits[i++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	while (i)
+		*out++ = digits[--i];
+
+	return out;
+}
+
+/* like "%#.2f" of the version divided by 100, and 0.00 if blank */
+static inline char *put_version(char *out, const unsigned char *data)
+{
+	unsigned int version = data[1] << 8 | data[0];
+
+	if (version == 0xffff)
+		version = 0;
+
+	out = put_uint(out, version / 100);
+	*out++ = '.';
+	*out++ = '0' + version % 100 / 10;
+	*out++ = '0' + version % 10;
+	return out;
+}
+
+static inline char *put_date(char *out, const unsigned char *data)
+{
+	static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+	if (data[0] < 10)
+		*out++ = '0';
+
+	out = put_uint(out, data[0]);
+	*out++ = '/';
+	if (data[1] >= 1 && data[1] <= 12)
+		out = put_str(out, months + (data[1] - 1) * 3, 3);
+	else
+		out = put_str(out, "BAD", 3);
+
+	*out++ = '/';
+	return put_uint(out, data[3] << 8 | data[2]);
+}
+
+/* the length of an ASCII value, which is 0 if the field is blank or zero */
+static inline int ascii_value_length(const unsigned char *data, int size)
+{
+	int i;
+
+	if (data[0] == 0 || data[0] == 0xff) {
+		for (i = 1; i < size && data[i] == data[0]; i++)
+			;
+
+		if (i == size)
+			return 0;
+	}
+
+	return strnlen((const char *)data, size);
+}
+
+static inline char *put_ascii(char *out, const unsigned char *data, int size)
+{
+	return put_str(out, (const char *)data,
+		       ascii_value_length(data, size));
+}
+
+static inline char *put_ascii_shell(char *out, const unsigned char *data,
+				    int size)
+{
+	int len = ascii_value_length(data, size);
+
+	*out++ = '\'';
+	for (int i = 0; i < len; i++) {
+		if (data[i] == '\'')
+			out = put_str(out, "'\\''", 4);
+		else
+			*out++ = data[i];
+	}
+
+	*out++ = '\'';
+	return out;
+}
+
+static inline char *put_ascii_udev(char *out, const unsigned char *data,
+				   int size)
+{
+	int len = ascii_value_length(data, size);
+
+	for (int i = 0; i < len; i++)
+		*out++ = data[i] < 32 || data[i] >= 127 ? '_' : data[i];
+
+	return out;
+}
+
+#endif
@@ -26,6 +26,12 @@
 #include <ctype.h>
 #include "common.h"
 #include "command.h"
+#include "store.h"
+#include "inventory.h"
+#include "daemon.h"
+#include "journal.h"
+#include "counter.h"
+#include "custom_layout.h"
 #include "auto_generated.h"
 
 #ifdef ENABLE_WRITE
@@ -46,27 +52,61 @@ static void print_help(void)
 {
 	print_banner();
 	printf("Usage: eeprom-util list [<bus_num>]\n");
-	printf("       eeprom-util read [-f <print_format>] [-l <layout_version>] <bus_num> <device_addr>\n");
+	printf("       eeprom-util read [-f <print_format> [-p <prefix>] [--mac-array] [--field-table]] [-l <layout_version>] [--cached [-d <cache_dir>]] <bus_num> <device_addr>\n");
+	printf("       eeprom-util read all [-f <print_format> [-p <prefix>] [--mac-array] [--field-table]] [-l <layout_version>] [<bus_num>]\n");
+	printf("       eeprom-util rescan [-f <print_format>] [-l <layout_version>] [-d <store_dir>] [-a <max_age>] [<bus_num>]\n");
+	printf("       eeprom-util blankcheck <bus_num> <device_addr>\n");
+	printf("       eeprom-util hash [--cached [-d <cache_dir>]] <bus_num> <device_addr>\n");
+	printf("       eeprom-util watch [-f <print_format>] [-l <layout_version>] [-t <interval>] [-b <budget>] <bus_num> <device_addr>\n");
+	printf("       eeprom-util counter%s [-l <layout_version>] [--span <start>-<end>] <bus_num> <device_addr>\n",
+	       write_enabled() ? " [inc [-j <journal_dir>]]" : "");
+	printf("       eeprom-util export-shm [-l <layout_version>] [--cached [-d <cache_dir>]] <bus_num> <device_addr>\n");
+	printf("       eeprom-util compare [-l <layout_version>] [-i <field>[,<field>]*] [-r] <golden_file> (<bus_num> <device_addr>)+\n");
+	printf("       eeprom-util compare [-l <layout_version>] [-i <field>[,<field>]*] [-r] <golden_file> all [<bus_num>]\n");
+	printf("       eeprom-util inventory add [-d <inventory_dir>] (<file>|<dir>)...\n");
+	printf("       eeprom-util inventory find [-d <inventory_dir>] (mac|sn) <value>\n");
+	printf("       eeprom-util inventory dups [-d <inventory_dir>]\n");
+	printf("       eeprom-util records [-f <print_format> [-p <prefix>] [--mac-array]] [-l <layout_version>] [<file>]\n");
 
 
 	if (write_enabled()) {
-		printf("       eeprom-util write (fields|bytes) [-l <layout_version>] <bus_num> <device_addr> DATA\n");
-		printf("       eeprom-util clear [fields|bytes|all] <bus_num> <device_addr> [DATA]\n");
+		printf("       eeprom-util write (fields|bytes) [-l <layout_version>] [--if-match <hash>] [-j <journal_dir>] <bus_num> <device_addr> DATA\n");
+		printf("       eeprom-util clear [fields|bytes|all] [--if-match <hash>] [-j <journal_dir>] <bus_num> <device_addr> [DATA]\n");
+		printf("       eeprom-util script [-f <print_format>] [-l <layout_version>] [--cached [-d <cache_dir>]] [--if-match <hash>] [-j <journal_dir>] <bus_num> <device_addr> [<file>]\n");
+		printf("       eeprom-util (resume|undo) [-j <journal_dir>] <bus_num> <device_addr>\n");
+		printf("       eeprom-util migrate <layout_version> [-l <layout_version>] [--dry-run] [-j <journal_dir>] <bus_num> <device_addr>\n");
 	}
 
+	printf("       eeprom-util daemon [-s <socket>]\n");
 	printf("       eeprom-util version|-v|--version\n");
 	printf("       eeprom-util [help|-h|--help]\n");
 
 	printf("\n"
 		"COMMANDS\n"
 		"   list 	List device addresses accessible via i2c\n"
-		"   read 	Read from EEPROM\n");
+		"   read 	Read from EEPROM. 'read all' reads every EEPROM found on all buses, or on the given bus\n"
+		"   rescan	Like 'read all', but reuse the images stored by the previous rescan when possible\n"
+		"   blankcheck	Check if all bytes of the EEPROM are 0xff. Fails if not\n"
+		"   hash		Print the hash of the EEPROM contents, for use with --if-match\n"
+		"   watch	Watch the EEPROM and print the fields which change\n"
+		"   export-shm	Export the fields of the EEPROM to a shared memory segment\n"
+		"   counter	Print a counter kept in reserved bytes of the EEPROM%s\n"
+		"   compare	Compare EEPROMs with a golden image file, except for the fields given with -i\n"
+		"   inventory	Collect MAC addresses and serial numbers from files, and look them up or find duplicates\n"
+		"   records	Print the devices of the records printed in the binary format, read from a file or standard input\n",
+		write_enabled() ? ". 'counter inc' increments it" : "");
 
 	if (write_enabled()) {
 		printf("   write	Write to EEPROM. Must specify if writing to 'fields' or 'bytes'\n");
-		printf("   clear	Clear EEPROM. Default is 'all'. Other options are clearing 'fields' or 'bytes'.\n");
+		printf("   clear	Clear EEPROM. Default is 'all', which skips pages that are already blank.\n"
+		       "		Other options are clearing 'fields' or 'bytes'.\n");
+		printf("   script	Run read, write and clear commands from a file or standard input against one image\n");
+		printf("   resume	Finish the last write to the EEPROM, if it was interrupted\n");
+		printf("   undo		Restore the bytes changed by the last write to the EEPROM\n");
+		printf("   migrate	Convert the EEPROM contents to another layout version\n");
 	}
 
+	printf("   daemon	Serve EEPROM reads and writes over a Unix socket, caching the EEPROM contents\n");
 	printf("   version	Print the version banner and exit\n"
 	       "   help		Print this help and exit\n");
 	printf("\n"
@@ -76,12 +116,88 @@ static void print_help(void)
 	       "   The following values can be provided with the -l option:\n"
 	       "      auto			use auto-detection to print layout\n"
 	       "      legacy, 1, 2, 3, 4	print according to layout version\n"
+	       "      5 to 31			print according to a custom layout version\n"
 	       "      raw			print raw data\n");
+	printf("\n"
+	       "CUSTOM LAYOUTS\n"
+	       "   Layout versions 5 to 31 are defined by files named <name>" LAYOUT_FILE_SUFFIX " in a layouts directory\n"
+	       "   (-L, default: " DEFAULT_LAYOUTS_DIR "), which apply to every command. A file holds a\n"
+	       "   'version <layout_version>' line, and a '<short_name> <size> <type> <name>' line per field in EEPROM order.\n"
+	       "   The types are binary, reversed, version, ascii, mac, date, reserved and crc32c:<start>-<end>, a 4 byte\n"
+	       "   CRC32C of the given bytes, which every write computes and every read checks. The bytes must not include\n"
+	       "   any crc32c field. Short names hold letters, digits and '_', and don't begin with a digit. The fields\n"
+	       "   must cover the EEPROM, and include a 1 byte field named 'layout' at offset %d, which holds the layout\n"
+	       "   version. '#' begins a comment. Invalid layout files are reported and skipped. The layouts are compiled\n"
+	       "   into " DEFAULT_CACHE_DIR "/" LAYOUTS_CACHE_FILE ", and compiled again when the files change.\n", LAYOUT_CHECK_BYTE);
 	printf("\n"
 	       "PRINT FORMAT\n"
 	       "   The following values can be provided with the -f option:\n"
 	       "      default	use the default user friendly output\n"
-	       "      dump	dump the data (usable for later input using \"write fields\")\n");
+	       "      dump	dump the data (usable for later input using \"write fields\")\n"
+	       "      shell	print each field as a shell variable assignment, i.e. EEPROM_MAC1=00:01:c0:13:91:d0\n"
+	       "      udev	print each field as a udev property, for use with IMPORT{program}\n"
+	       "      json	print a JSON object per device, keyed by the short field names, i.e. {\"mac1\":\"00:01:c0:13:91:d0\"}\n"
+	       "      binary	print a binary record per device, holding its bus, address, detected layout version and image\n"
+	       "   The names of the shell variables and udev properties begin with a prefix (-p, default: " DEFAULT_PRINT_PREFIX ").\n"
+	       "   In the json format, versions are numbers and other values are strings. With --mac-array, MAC addresses\n"
+	       "   are arrays of byte values. Devices found by 'read all', 'rescan' and 'watch' are objects holding the\n"
+	       "   i2c_bus and i2c_addr of the device, and its fields, or its event and the old and new changed fields.\n"
+	       "   The binary records are described by record.h. With --field-table, a record also describes the offsets\n"
+	       "   and sizes of the fields. 'watch' prints a record whenever the image changes. The 'records' command\n"
+	       "   prints the devices of records in any other format, by their recorded layout version unless -l is given.\n");
+
+	printf("\n"
+	       "CACHE\n"
+	       "   With --cached, the image of the device and its detected layout version are kept in a cache directory\n"
+	       "   (-d, default: " DEFAULT_CACHE_DIR "). The cached image is used if the production date, serial number and the\n"
+	       "   bytes its layout is detected by, read from the device, still match it. Otherwise the entire device is read and cached again.\n"
+	       "   Write commands always update the cached image of the device, if it has one.\n");
+	printf("\n"
+	       "RESCAN\n"
+	       "   The rescan command keeps the image of each device in a store directory (-d, default: " DEFAULT_STORE_DIR ").\n"
+	       "   A stored image is used if the device's production date, serial number and the bytes its layout is detected\n"
+	       "   by still match it, and it is not older than the maximum age in seconds (-a, default: one week).\n"
+	       "   Otherwise the entire device is read and stored again.\n");
+
+	printf("\n"
+	       "DAEMON\n"
+	       "   The daemon listens on a Unix socket (-s, default: " DEFAULT_DAEMON_SOCKET ") and keeps the image of every\n"
+	       "   EEPROM it was asked about. Any command which accesses a single device can be given '-s <socket>'\n"
+	       "   to read the cached image instead of the device, and to write through the daemon. Sending SIGHUP to\n"
+	       "   the daemon drops all cached images.\n");
+	printf("\n"
+	       "WATCH\n"
+	       "   Every interval (-t, default: %d seconds), up to <budget> bytes (-b, default: the fingerprint) of the\n"
+	       "   production date, serial number and layout version are read. Any budget left is spent on the rest of\n"
+	       "   the EEPROM, a part on every interval. The EEPROM is read entirely only when a read byte changed, and\n"
+	       "   the changed fields are printed. Removal and insertion of the device are reported as well.\n",
+	       DEFAULT_WATCH_INTERVAL);
+	printf("\n"
+	       "EXPORT-SHM\n"
+	       "   The fields are exported to /dev/shm/eeprom-util-<bus_num>-00<device_addr>, which has a fixed size\n"
+	       "   layout that is described by shm.h. Exporting again updates the segment in place.\n");
+	printf("\n"
+	       "COUNTER\n"
+	       "   The counter is kept in a span of reserved bytes (--span, default: %d-%d), made of %d byte slots.\n"
+	       "   The span must only cover reserved fields of the layout of the EEPROM (-l, default: detected), and\n"
+	       "   no bytes covered by a checksum.\n"
+	       "   Each increment writes only the next slot, so the slots wear evenly. A torn slot is ignored, which\n"
+	       "   keeps the previous value. Reading the counter reads the EEPROM once. An increment first finishes\n"
+	       "   an interrupted write (-j), like write commands do, and updates the cached image of the device.\n",
+	       DEFAULT_COUNTER_START, DEFAULT_COUNTER_END, COUNTER_SLOT_SIZE);
+	printf("\n"
+	       "COMPARE\n"
+	       "   The golden image is a raw %d byte image. Ignored fields are given by name, using the layout of the golden image.\n"
+	       "   Each device is compared until the first mismatch. With -r, the first mismatch of every field is reported.\n"
+	       "   'all' compares every EEPROM found on all buses, or on the given bus. The command fails if any device differs.\n",
+	       EEPROM_SIZE);
+	printf("\n"
+	       "INVENTORY\n"
+	       "   The inventory is kept in a directory (-d, default: " DEFAULT_INVENTORY_DIR ").\n"
+	       "   'add' ingests files with the output of 'read -f dump' or 'read all -f dump', or raw 256 byte images.\n"
+	       "   Directories are ingested file by file. Entries of a previously ingested file with the same name are replaced.\n"
+	       "   'find' prints the files which contain the given MAC address or serial number.\n"
+	       "   'dups' prints every MAC address and serial number found in more than one device, and fails if any exist.\n");
 
 	if (write_enabled()) {
 		printf("\n"
@@ -126,6 +242,43 @@ static void print_help(void)
 			"      Production Date=01/Feb/2018\n"
 			"      1st MAC Address=01:23:45:67:89:ab\n"
 			);
+
+		printf("\n"
+			"SCRIPT\n"
+			"   A script holds one command per line, which is one of 'read' or 'clear [all]', or one of 'write fields',\n"
+			"   'write bytes', 'clear fields' and 'clear bytes' followed by one data entry, as on standard input:\n"
+			"      write fields Production Date=01/Feb/2018\n"
+			"      write bytes 0x80,0x41,0x42\n"
+			"      read\n"
+			"   The EEPROM is read once, and the commands are applied to its image in order. 'read' prints the image.\n"
+			"   Only the pages which changed are written, once all commands succeeded. Nothing is written otherwise.\n"
+			);
+
+		printf("\n"
+			"CONCURRENT UPDATES\n"
+			"   Write and clear commands only write the pages they changed. Right before writing, those pages are\n"
+			"   read again. If another writer changed them since the EEPROM was read, the changes are applied again\n"
+			"   to the new contents, up to %d times. Scripts fail instead, as their reads were already printed.\n"
+			"   With --if-match <hash>, the command fails unless the EEPROM contents match the hash printed by\n"
+			"   the hash command, and also if the pages changed before writing them.\n",
+			CONFLICT_RETRIES);
+
+		printf("\n"
+			"JOURNAL\n"
+			"   Before writing, the EEPROM contents before and after the write, and the pages about to be written,\n"
+			"   are saved to a journal (-j, default: " DEFAULT_JOURNAL_DIR "). Pages are marked as done as they are\n"
+			"   written. If a write is interrupted, the next write or clear command first finishes the pending pages,\n"
+			"   as does 'resume'. 'undo' restores the bytes changed by the last write instead, even if it was interrupted.\n"
+			"   Only the bytes which differ are written. Undoing twice redoes the write.\n"
+			);
+
+		printf("\n"
+			"MIGRATE\n"
+			"   Migration converts layouts 1 to 4 and custom layouts to one another. Each field of the target layout takes the value\n"
+			"   of the field with the same short name in the current layout (-l, default: auto). New fields are\n"
+			"   cleared, the layout version is set, and reserved bytes are kept if they were reserved before.\n"
+			"   Only the bytes which change are written. --dry-run prints them along with their target fields.\n"
+			);
 	}
 
 	printf("\n");
@@ -161,7 +314,38 @@ static enum action parse_action(int argc, char *argv[])
 	if (!strncmp(argv[0], "list", 4)) {
 		return EEPROM_LIST;
 	} else if (!strncmp(argv[0], "read", 4)) {
+		if (argc > 1 && (!strncmp(argv[1], "all", 3)))
+			return EEPROM_READ_ALL;
+
 		return EEPROM_READ;
+	} else if (!strncmp(argv[0], "rescan", 6)) {
+		return EEPROM_RESCAN;
+	} else if (!strncmp(argv[0], "hash", 4)) {
+		return EEPROM_HASH;
+	} else if (!strncmp(argv[0], "watch", 5)) {
+		return EEPROM_WATCH;
+	} else if (!strncmp(argv[0], "export-shm", 10)) {
+		return EEPROM_EXPORT_SHM;
+	} else if (!strncmp(argv[0], "blankcheck", 10)) {
+		return EEPROM_BLANK_CHECK;
+	} else if (!strncmp(argv[0], "daemon", 6)) {
+		return EEPROM_DAEMON;
+	} else if (!strncmp(argv[0], "records", 7)) {
+		return EEPROM_RECORDS;
+	} else if (!strncmp(argv[0], "counter", 7)) {
+		if (write_enabled() && argc > 1 && !strncmp(argv[1], "inc", 3))
+			return EEPROM_COUNTER_INC;
+
+		return EEPROM_COUNTER;
+	} else if (!strncmp(argv[0], "compare", 7)) {
+		return EEPROM_COMPARE;
+	} else if (!strncmp(argv[0], "inventory", 9)) {
+		if (argc > 1 && (!strncmp(argv[1], "add", 3)))
+			return EEPROM_INVENTORY_ADD;
+		if (argc > 1 && (!strncmp(argv[1], "find", 4)))
+			return EEPROM_INVENTORY_FIND;
+		if (argc > 1 && (!strncmp(argv[1], "dups", 4)))
+			return EEPROM_INVENTORY_DUPS;
 	} else if (write_enabled() && !strncmp(argv[0], "clear", 5)) {
 		if (argc > 1 && (!strncmp(argv[1], "fields", 6)))
 			return EEPROM_CLEAR_FIELDS;
@@ -169,6 +353,14 @@ static enum action parse_action(int argc, char *argv[])
 			return EEPROM_CLEAR_BYTES;
 
 		return EEPROM_CLEAR;
+	} else if (write_enabled() && !strncmp(argv[0], "script", 6)) {
+		return EEPROM_SCRIPT;
+	} else if (write_enabled() && !strncmp(argv[0], "resume", 6)) {
+		return EEPROM_RESUME;
+	} else if (write_enabled() && !strncmp(argv[0], "undo", 4)) {
+		return EEPROM_UNDO;
+	} else if (write_enabled() && !strncmp(argv[0], "migrate", 7)) {
+		return EEPROM_MIGRATE;
 	} else if (write_enabled() && !strncmp(argv[0], "write", 5)) {
 		if (argc > 1) {
 			if (!strncmp(argv[1], "fields", 6)) {
@@ -223,11 +415,89 @@ static enum print_format parse_print_format(char *str)
 		return FORMAT_DEFAULT;
 	else if (!strncmp(str, "dump", 4))
 		return FORMAT_DUMP;
+	else if (!strncmp(str, "shell", 5))
+		return FORMAT_SHELL;
+	else if (!strncmp(str, "udev", 4))
+		return FORMAT_UDEV;
+	else if (!strncmp(str, "json", 4))
+		return FORMAT_JSON;
+	else if (!strncmp(str, "binary", 6))
+		return FORMAT_BINARY;
 
 	message_exit("Unknown print format!\n");
 	return FORMAT_DEFAULT; //To appease the compiler
 }
 
+static int parse_max_age(char *str)
+{
+	ASSERT(str);
+
+	int value;
+	if (strtoi(&str, &value) != STRTOI_STR_END || value < 0)
+		message_exit("Invalid maximum age!\n");
+
+	return value;
+}
+
+/* The prefix is part of shell variable names, so it must be usable in one */
+static char *parse_print_prefix(char *str)
+{
+	ASSERT(str);
+
+	for (char *c = str; *c; c++)
+		if (!isalnum(*c) && *c != '_')
+			message_exit("Invalid print prefix!\n");
+
+	if (isdigit(*str))
+		message_exit("Invalid print prefix!\n");
+
+	return str;
+}
+
+static uint64_t parse_hash(char *str)
+{
+	ASSERT(str);
+
+	char *end;
+	errno = 0;
+	uint64_t value = strtoull(str, &end, 16);
+	if (errno || end == str || *end || *str == '-')
+		message_exit("Invalid hash!\n");
+
+	return value;
+}
+
+/* A counter span must hold whole slots, and at least two of them */
+static struct bytes_range parse_counter_span(char *str)
+{
+	ASSERT(str);
+
+	struct bytes_range span;
+	if (strtoi(&str, &span.start) != STRTOI_STR_CON || *str != '-')
+		message_exit("Invalid counter span!\n");
+
+	str++;
+	if (strtoi(&str, &span.end) != STRTOI_STR_END ||
+	    span.start < 0 || span.end >= EEPROM_SIZE ||
+	    span.start % COUNTER_SLOT_SIZE ||
+	    (span.end + 1) % COUNTER_SLOT_SIZE ||
+	    span.end - span.start + 1 < 2 * COUNTER_SLOT_SIZE)
+		message_exit("Invalid counter span!\n");
+
+	return span;
+}
+
+static int parse_positive(char *str, const char *error)
+{
+	ASSERT(str && error);
+
+	int value;
+	if (strtoi(&str, &value) != STRTOI_STR_END || value <= 0)
+		message_exit(error);
+
+	return value;
+}
+
 static int parse_i2c_bus(char *str)
 {
 	ASSERT(str);
@@ -262,6 +532,40 @@ static int parse_i2c_addr(char *str)
 	return value;
 }
 
+/*
+ * parse_devices - parse pairs of bus and address strings
+ *
+ * @input:	A string array of bus and address pairs
+ * @size:	The size of input[]
+ * @data:	A pointer to a data array where to save the result
+ *
+ * Returns:	0 on success. -EINVAL or -ENOMEM on failure.
+ */
+static int parse_devices(char *input[], int size, struct data_array *data)
+{
+	ASSERT(input && data);
+
+	if (size % 2) {
+		ieprintf("Missing I2C address for bus \"%s\"", input[size - 1]);
+		return -EINVAL;
+	}
+
+	struct i2c_device *devices = malloc(sizeof(*devices) * size / 2);
+	if (!devices) {
+		perror(STR_ENO_MEM);
+		return -ENOMEM;
+	}
+
+	for (int i = 0; i < size / 2; i++) {
+		devices[i].bus = parse_i2c_bus(input[2 * i]);
+		devices[i].addr = parse_i2c_addr(input[2 * i + 1]);
+	}
+
+	data->devices = devices;
+	data->size = size / 2;
+	return 0;
+}
+
 #ifdef ENABLE_WRITE
 // The max size of a conventional line from stdin. defined as:
 // MAX[ (field name) + (1 for '=') + (field value) + (1 for '/0') ]
@@ -405,7 +709,7 @@ static int read_lines_stdin(char ***input, int *size)
 
 	char *line;
 	int ret = read_line_stdin(&line);
-	if (ret || !line)
+	if (ret)
 		goto cleanup;
 
 	while (line) {
@@ -663,6 +967,133 @@ syntax_error:
 	return -EINVAL;
 }
 
+/*
+ * next_word - split the first word off a string
+ *
+ * @str:	A pointer to the string. Updated to point at the next word.
+ *
+ * Returns:	The first word, terminated.
+ */
+static char *next_word(char **str)
+{
+	ASSERT(str && *str);
+
+	while (isblank(**str))
+		(*str)++;
+
+	char *word = *str;
+	while (**str && !isblank(**str))
+		(*str)++;
+
+	if (**str) {
+		*(*str)++ = '\0';
+		while (isblank(**str))
+			(*str)++;
+	}
+
+	return word;
+}
+
+static void free_script(struct data_array *data)
+{
+	for (int i = 0; i < data->size; i++) {
+		struct script_step *step = &data->script_steps[i];
+		if (step->action == EEPROM_WRITE_FIELDS)
+			free(step->data.fields_changes);
+		else if (step->action == EEPROM_WRITE_BYTES)
+			free(step->data.bytes_changes);
+		else if (step->action == EEPROM_CLEAR_BYTES)
+			free(step->data.bytes_list);
+	}
+
+	free(data->script_steps);
+}
+
+/*
+ * parse_script - parse the lines of a script into script steps
+ *
+ * Each line holds one command: "read", "clear [all]", or one of "write
+ * fields", "write bytes", "clear fields" and "clear bytes" followed by one
+ * data entry, in the same format as a line of standard input.
+ *
+ * @input:	A string array of script lines
+ * @size:	The size of input[]
+ * @data:	A pointer to a data array where to save the result
+ *
+ * Returns:	0 on success. -EINVAL or -ENOMEM on failure.
+ */
+static int parse_script(char *input[], int size, struct data_array *data)
+{
+	ASSERT(input && data);
+	ASSERT(size > 0);
+
+	data->script_steps = calloc(size, sizeof(struct script_step));
+	if (!data->script_steps) {
+		perror(STR_ENO_MEM);
+		return -ENOMEM;
+	}
+
+	int i, ret = 0;
+	char *command, *qualifier;
+	for (i = 0; i < size; i++) {
+		struct script_step *step = &data->script_steps[i];
+		char *line = input[i];
+		command = next_word(&line);
+		qualifier = next_word(&line);
+
+		if (!strcmp(command, "read") && !*qualifier) {
+			step->action = EEPROM_READ;
+			continue;
+		}
+
+		if (!strcmp(command, "clear") && !*line &&
+		    (!*qualifier || !strcmp(qualifier, "all"))) {
+			step->action = EEPROM_CLEAR;
+			continue;
+		}
+
+		/* the entry is the rest of the line, which may hold spaces */
+		if (!*line)
+			goto invalid;
+
+		if (!strcmp(command, "write") && !strcmp(qualifier, "fields")) {
+			step->action = EEPROM_WRITE_FIELDS;
+			ret = parse_field_changes(&line, 1, &step->data);
+		} else if (!strcmp(command, "write") &&
+			   !strcmp(qualifier, "bytes")) {
+			step->action = EEPROM_WRITE_BYTES;
+			ret = parse_bytes_changes(&line, 1, &step->data);
+		} else if (!strcmp(command, "clear") &&
+			   !strcmp(qualifier, "fields")) {
+			/* keep the field name at the start of the line */
+			memmove(input[i], line, strlen(line) + 1);
+			step->action = EEPROM_CLEAR_FIELDS;
+			step->data.fields_list = &input[i];
+			step->data.size = 1;
+		} else if (!strcmp(command, "clear") &&
+			   !strcmp(qualifier, "bytes")) {
+			step->action = EEPROM_CLEAR_BYTES;
+			ret = parse_bytes_list(&line, 1, &step->data);
+		} else {
+			goto invalid;
+		}
+
+		if (ret)
+			goto error;
+	}
+
+	data->size = size;
+	return 0;
+
+invalid:
+	ieprintf("Invalid script command \"%s %s\"", command, qualifier);
+	ret = -EINVAL;
+error:
+	data->size = i;
+	free_script(data);
+	return ret;
+}
+
 #else
 static inline int add_lines_from_stdin(char ***input, int *size)
 {
@@ -686,6 +1117,21 @@ static inline int parse_field_changes(char *input[], int size,
 {
 	return -ENOSYS;
 }
+
+static inline int read_lines_stdin(char ***input, int *size)
+{
+	return -ENOSYS;
+}
+
+static inline int parse_script(char *input[], int size,
+	struct data_array *data)
+{
+	return -ENOSYS;
+}
+
+static inline void free_script(struct data_array *data)
+{
+}
 #endif
 
 #define NEXT_PARAM(argc, argv)	{(argc)--; (argv)++;}
@@ -696,6 +1142,11 @@ int main(int argc, char *argv[])
 	struct options options = {
 		.layout_ver	= LAYOUT_AUTODETECT,
 		.print_format	= FORMAT_DEFAULT,
+		.max_age	= DEFAULT_STORE_MAX_AGE,
+		.interval	= DEFAULT_WATCH_INTERVAL,
+		.journal_dir	= DEFAULT_JOURNAL_DIR,
+		.layouts_dir	= DEFAULT_LAYOUTS_DIR,
+		.counter_span	= { DEFAULT_COUNTER_START, DEFAULT_COUNTER_END },
 	};
 	struct data_array data;
 	int ret = -1, parse_ret = 0, input_size = 0;
@@ -714,15 +1165,69 @@ int main(int argc, char *argv[])
 
 	// parse_action already took care of parsing the bytes/fields qualifier
 	if (action == EEPROM_WRITE_BYTES || action == EEPROM_WRITE_FIELDS ||
-	    action == EEPROM_CLEAR_FIELDS || action == EEPROM_CLEAR_BYTES)
+	    action == EEPROM_CLEAR_FIELDS || action == EEPROM_CLEAR_BYTES ||
+	    action == EEPROM_READ_ALL || action == EEPROM_INVENTORY_ADD ||
+	    action == EEPROM_INVENTORY_FIND || action == EEPROM_INVENTORY_DUPS ||
+	    action == EEPROM_COUNTER_INC)
 		NEXT_PARAM(argc, argv);
 
+	if (action == EEPROM_MIGRATE) {
+		cond_usage_exit(argc < 1, "Missing target layout version!\n");
+		options.target_layout = parse_layout_version(argv[0]);
+		if (options.target_layout < LAYOUT_VER1 ||
+		    options.target_layout >= LAYOUT_UNRECOGNIZED)
+			message_exit("Invalid target layout version!\n");
+
+		NEXT_PARAM(argc, argv);
+	}
+
 	// The "all" qualifier is optional for clear command
 	if (action == EEPROM_CLEAR && argc > 0 && !strncmp(argv[0], "all", 3))
 		NEXT_PARAM(argc, argv);
 
 	// parse optional parameters
 	while (argc > 0 && argv[0][0] == '-') {
+		if (!strcmp(argv[0], "--cached")) {
+			options.cached = true;
+			NEXT_PARAM(argc, argv);
+			continue;
+		}
+
+		if (!strcmp(argv[0], "--dry-run")) {
+			options.dry_run = true;
+			NEXT_PARAM(argc, argv);
+			continue;
+		}
+
+		if (!strcmp(argv[0], "--mac-array")) {
+			options.mac_array = true;
+			NEXT_PARAM(argc, argv);
+			continue;
+		}
+
+		if (!strcmp(argv[0], "--field-table")) {
+			options.field_table = true;
+			NEXT_PARAM(argc, argv);
+			continue;
+		}
+
+		if (!strcmp(argv[0], "--span")) {
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing counter span!\n");
+			options.counter_span = parse_counter_span(argv[0]);
+			NEXT_PARAM(argc, argv);
+			continue;
+		}
+
+		if (!strcmp(argv[0], "--if-match")) {
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing hash!\n");
+			options.if_match = true;
+			options.match_hash = parse_hash(argv[0]);
+			NEXT_PARAM(argc, argv);
+			continue;
+		}
+
 		switch (argv[0][1]) {
 		case 'l':
 			NEXT_PARAM(argc, argv);
@@ -734,6 +1239,56 @@ int main(int argc, char *argv[])
 			cond_usage_exit(argc < 1, "Missing print format!\n");
 			options.print_format = parse_print_format(argv[0]);;
 			break;
+		case 'd':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing store directory!\n");
+			options.store_dir = argv[0];
+			break;
+		case 'a':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing maximum age!\n");
+			options.max_age = parse_max_age(argv[0]);
+			break;
+		case 'i':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing ignored fields!\n");
+			options.ignore_fields = argv[0];
+			break;
+		case 'r':
+			options.full_report = true;
+			break;
+		case 'p':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing print prefix!\n");
+			options.print_prefix = parse_print_prefix(argv[0]);
+			break;
+		case 't':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing watch interval!\n");
+			options.interval = parse_positive(argv[0],
+						"Invalid watch interval!\n");
+			break;
+		case 'b':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing watch budget!\n");
+			options.budget = parse_positive(argv[0],
+						"Invalid watch budget!\n");
+			break;
+		case 's':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing daemon socket!\n");
+			options.socket_path = argv[0];
+			break;
+		case 'j':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing journal directory!\n");
+			options.journal_dir = argv[0];
+			break;
+		case 'L':
+			NEXT_PARAM(argc, argv);
+			cond_usage_exit(argc < 1, "Missing layouts directory!\n");
+			options.layouts_dir = argv[0];
+			break;
 		default:
 			message_exit("Invalid option parameter!\n");
 		}
@@ -741,20 +1296,107 @@ int main(int argc, char *argv[])
 		NEXT_PARAM(argc, argv);
 	}
 
+	if (action == EEPROM_DAEMON) {
+		if (!options.socket_path)
+			options.socket_path = DEFAULT_DAEMON_SOCKET;
+		goto done;
+	}
+
+	if (action == EEPROM_INVENTORY_ADD || action == EEPROM_INVENTORY_FIND ||
+	    action == EEPROM_INVENTORY_DUPS) {
+		if (!options.store_dir)
+			options.store_dir = DEFAULT_INVENTORY_DIR;
+
+		cond_usage_exit(action == EEPROM_INVENTORY_ADD && argc < 1,
+				"Missing files to add!\n");
+		cond_usage_exit(action == EEPROM_INVENTORY_FIND && argc != 2,
+				"Expected a key type and a key!\n");
+		data.fields_list = argv;
+		data.size = argc;
+		goto done;
+	}
+
+	if (action == EEPROM_RECORDS) {
+		if (argc > 0 && !freopen(argv[0], "r", stdin)) {
+			eprintf("Failed opening %s: %s (%d)\n", argv[0],
+				strerror(errno), -errno);
+			return 1;
+		}
+
+		goto done;
+	}
+
+	if (!options.store_dir)
+		options.store_dir = action == EEPROM_RESCAN ? DEFAULT_STORE_DIR :
+							      DEFAULT_CACHE_DIR;
+
+	if (action == EEPROM_COMPARE) {
+		cond_usage_exit(argc < 1, "Missing golden image file!\n");
+		options.golden_file = argv[0];
+		NEXT_PARAM(argc, argv);
+		cond_usage_exit(argc < 1, "Missing devices to compare!\n");
+		if (!strncmp(argv[0], "all", 3)) {
+			NEXT_PARAM(argc, argv);
+			options.i2c_bus = argc > 0 ? parse_i2c_bus(argv[0]) : -1;
+			data.size = 0;
+			goto done;
+		}
+
+		parse_ret = parse_devices(argv, argc, &data);
+		if (parse_ret)
+			goto clean_input;
+
+		goto done;
+	}
+
+	// The bus is optional for read all. Scan all buses if omitted
+	if ((action == EEPROM_READ_ALL || action == EEPROM_RESCAN) &&
+	    argc == 0) {
+		options.i2c_bus = -1;
+		goto done;
+	}
+
 	cond_usage_exit(argc < 1, "Missing I2C bus & address parameters!\n");
 	options.i2c_bus = parse_i2c_bus(argv[0]);
 	NEXT_PARAM(argc, argv);
 
-	if (action == EEPROM_LIST)
+	if (action == EEPROM_LIST || action == EEPROM_READ_ALL ||
+	    action == EEPROM_RESCAN)
 		goto done;
 
 	cond_usage_exit(argc < 1, "Missing I2C address parameter!\n");
 	options.i2c_addr = parse_i2c_addr(argv[0]);
 	NEXT_PARAM(argc, argv);
 
-	if (action == EEPROM_READ || action == EEPROM_CLEAR)
+	if (action == EEPROM_READ || action == EEPROM_CLEAR ||
+	    action == EEPROM_BLANK_CHECK || action == EEPROM_EXPORT_SHM ||
+	    action == EEPROM_WATCH || action == EEPROM_HASH ||
+	    action == EEPROM_RESUME || action == EEPROM_UNDO ||
+	    action == EEPROM_MIGRATE ||
+	    action == EEPROM_COUNTER || action == EEPROM_COUNTER_INC)
 		goto done;
 
+	if (action == EEPROM_SCRIPT) {
+		if (argc > 0 && !freopen(argv[0], "r", stdin)) {
+			eprintf("Failed opening %s: %s (%d)\n", argv[0],
+				strerror(errno), -errno);
+			return 1;
+		}
+
+		// All of the input lines are read from the script
+		argc = 0;
+		is_stdin = true;
+		if (read_lines_stdin(&input, &input_size))
+			return 1;
+
+		cond_usage_exit(input_size == 0, "Missing script commands!\n");
+		parse_ret = parse_script(input, input_size, &data);
+		if (parse_ret)
+			goto clean_input;
+
+		goto done;
+	}
+
 	input = argv;
 	input_size = argc;
 	if (is_stdin && add_lines_from_stdin(&input, &input_size))
@@ -791,6 +1433,10 @@ done:
 		free(data.bytes_changes);
 	else if (action == EEPROM_CLEAR_BYTES)
 		free(data.bytes_list);
+	else if (action == EEPROM_COMPARE && data.size)
+		free(data.devices);
+	else if (action == EEPROM_SCRIPT)
+		free_script(&data);
 
 clean_input:
 	if (input && is_stdin) {
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "layout.h"
+#include "output.h"
+#include "record.h"
+
+/*
+ * print_record() - print the record of a device in the binary format
+ * @layout:		The layout of the device
+ * @i2c_bus:		The bus of the device
+ * @i2c_addr:		The address of the device
+ * @field_table:	Whether to describe the fields of the layout
+ *
+ * The record is built in the output buffer, and written with a single
+ * write().
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int print_record(const struct layout *layout, int i2c_bus, int i2c_addr,
+		 bool field_table)
+{
+	ASSERT(layout && layout->fields && layout->data);
+
+	struct record_header header = {
+		.version	= RECORD_VERSION,
+		.image_size	= layout->data_size,
+		.i2c_bus	= i2c_bus,
+		.i2c_addr	= i2c_addr,
+		.layout_version	= layout->layout_version,
+	};
+
+	memcpy(header.magic, RECORD_MAGIC, RECORD_MAGIC_SIZE);
+	for (int i = 0; field_table && i < layout->num_of_fields; i++)
+		if (layout->fields[i].type != FIELD_RESERVED)
+			header.num_fields++;
+
+	header.size = sizeof(header) + header.image_size +
+		      header.num_fields * sizeof(struct record_field);
+	char *out = out_reserve(header.size);
+	if (!out) {
+		eprintf("%s\n", STR_ENO_MEM);
+		return -1;
+	}
+
+	out = put_str(out, (char *)&header, sizeof(header));
+	out = put_str(out, (char *)layout->data, header.image_size);
+	for (int i = 0; field_table && i < layout->num_of_fields; i++) {
+		const struct field_desc *desc = &layout->fields[i];
+		struct record_field field = {
+			.type	= desc->type,
+			.offset	= desc->offset,
+			.size	= desc->data_size,
+		};
+
+		if (desc->type == FIELD_RESERVED)
+			continue;
+
+		strncpy(field.name, desc->short_name, RECORD_NAME_SIZE - 1);
+		out = put_str(out, (char *)&field, sizeof(field));
+	}
+
+	out_commit(out);
+	return out_flush();
+}
+
+/*
+ * read_record() - read the next record printed in the binary format
+ * @file:	Where to read the record from
+ * @header:	Where to save the header of the record
+ * @image:	Where to save the image, which must be EEPROM_SIZE bytes. The
+ *		bytes past the image of the record are blank.
+ *
+ * The field table is skipped, as the layout describes the fields.
+ *
+ * Returns: 1 if a record was read, 0 if there are no more records, -1 if the
+ * record is invalid.
+ */
+int read_record(FILE *file, struct record_header *header,
+		unsigned char *image)
+{
+	ASSERT(file && header && image);
+
+	unsigned char skipped[EEPROM_SIZE];
+	size_t size = fread(header, 1, sizeof(*header), file);
+
+	if (size == 0 && feof(file))
+		return 0;
+
+	if (size != sizeof(*header) ||
+	    memcmp(header->magic, RECORD_MAGIC, RECORD_MAGIC_SIZE) ||
+	    header->version != RECORD_VERSION ||
+	    header->image_size > EEPROM_SIZE ||
+	    header->size != sizeof(*header) + header->image_size +
+			    header->num_fields * sizeof(struct record_field))
+		goto invalid;
+
+	memset(image + header->image_size, 0xff,
+	       EEPROM_SIZE - header->image_size);
+	if (fread(image, 1, header->image_size, file) != header->image_size)
+		goto invalid;
+
+	/* standard input may be a pipe, so the table is read, not seeked */
+	size = header->size - sizeof(*header) - header->image_size;
+	while (size > 0) {
+		size_t chunk = size < sizeof(skipped) ? size : sizeof(skipped);
+		if (fread(skipped, 1, chunk, file) != chunk)
+			goto invalid;
+
+		size -= chunk;
+	}
+
+	return 1;
+
+invalid:
+	ieprintf("Invalid record");
+	return -1;
+}
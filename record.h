@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORD_
+#define _RECORD_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ * The records printed by the binary print format, one per device. The
+ * structures below are self contained, so collectors may include them as is.
+ *
+ * A record begins with a struct record_header, whose first member is the
+ * size of the entire record, followed by the image_size bytes of the EEPROM
+ * image, followed by num_fields descriptors of the fields of the detected
+ * layout if --field-table was given. Reserved fields are not described.
+ * Multi-byte values are in the byte order of the host which printed them.
+ */
+
+#define RECORD_MAGIC		"EEPR"
+#define RECORD_MAGIC_SIZE	4
+#define RECORD_VERSION		2
+#define RECORD_NAME_SIZE	16
+
+struct record_field {
+	char name[RECORD_NAME_SIZE];	/* short name, i.e. "mac1" */
+	unsigned char type;		/* enum field_type */
+	unsigned char reserved;
+	unsigned short offset;		/* offset of the field in the image */
+	unsigned short size;		/* size of the field */
+};
+
+struct record_header {
+	unsigned int size;		/* of the record, including the header */
+	char magic[RECORD_MAGIC_SIZE];
+	unsigned short version;
+	unsigned short image_size;
+	unsigned short num_fields;
+	unsigned short i2c_bus;
+	unsigned char i2c_addr;
+	unsigned char layout_version;	/* enum layout_version, as detected */
+	unsigned char reserved[2];
+};
+
+struct layout;
+
+int print_record(const struct layout *layout, int i2c_bus, int i2c_addr,
+		 bool field_table);
+int read_record(FILE *file, struct record_header *header,
+		unsigned char *image);
+
+#endif
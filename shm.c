@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "layout.h"
+#include "shm.h"
+
+#define SHM_NAME_MAX	64
+
+/*
+ * copy_value() - copy the value of a field to the snapshot in the order
+ * described in shm.h.
+ *
+ * Returns: the size of the copied value.
+ */
+static int copy_value(unsigned char *dest, const struct field *field)
+{
+	int size = field->desc->data_size;
+	int i;
+
+	switch (field->desc->type) {
+	case FIELD_REVERSED:
+		for (i = 0; i < size; i++)
+			dest[i] = field->data[size - 1 - i];
+		return size;
+	case FIELD_ASCII:
+		/* a blank field is an empty string, like print_ascii() does */
+		for (i = 0; i < size && field->data[i] == 0xff; i++)
+			;
+		size = i == size ? 0 : strnlen((char *)field->data, size);
+		memcpy(dest, field->data, size);
+		dest[size] = '\0';
+		return field->desc->data_size + 1;
+	default:
+		memcpy(dest, field->data, size);
+		return size;
+	}
+}
+
+/*
+ * build_snapshot() - build the contents of the segment in a local buffer, so
+ * the segment itself is only locked for a single copy.
+ *
+ * Returns: 0 on success, -1 if the layout doesn't fit in the segment.
+ */
+static int build_snapshot(unsigned char *snapshot, const struct layout *layout,
+			  int i2c_bus, int i2c_addr)
+{
+	struct shm_header *header = (struct shm_header *)snapshot;
+	int num_fields = 0;
+
+	for (int i = 0; i < layout->num_of_fields; i++)
+		if (layout->fields[i].type != FIELD_RESERVED)
+			num_fields++;
+
+	size_t offset = sizeof(*header) + num_fields * sizeof(struct shm_field);
+
+	memset(snapshot, 0, SHM_SEGMENT_SIZE);
+	memcpy(header->magic, SHM_MAGIC, SHM_MAGIC_SIZE);
+	header->version = SHM_VERSION;
+	header->num_fields = num_fields;
+	header->layout_version = layout->layout_version;
+	header->i2c_bus = i2c_bus;
+	header->i2c_addr = i2c_addr;
+
+	struct shm_field *desc = header->fields;
+	for (int i = 0; i < layout->num_of_fields; i++) {
+		struct field field = layout_field(layout, i);
+		if (field.desc->type == FIELD_RESERVED)
+			continue;
+
+		/* room for the NUL terminator of ASCII values */
+		if (offset + field.desc->data_size + 1 > SHM_SEGMENT_SIZE) {
+			ieprintf("Layout does not fit in the shared memory segment");
+			return -1;
+		}
+
+		strncpy(desc->name, field.desc->short_name, SHM_NAME_SIZE - 1);
+		desc->type = field.desc->type;
+		desc->eeprom_offset = field.desc->offset;
+		desc->offset = offset;
+		desc->size = copy_value(snapshot + offset, &field);
+		offset += desc->size;
+		desc++;
+	}
+
+	return 0;
+}
+
+/*
+ * publish() - copy the snapshot into the mapped segment under the seqlock
+ *
+ * The sequence is left as is by the copy, so readers see it go odd, then
+ * even again once the new contents are in place.
+ */
+static void publish(struct shm_header *segment, const unsigned char *snapshot)
+{
+	size_t start = offsetof(struct shm_header, version);
+	unsigned int seq = __atomic_load_n(&segment->sequence, __ATOMIC_RELAXED);
+
+	/* an odd sequence was left by a writer which didn't finish */
+	seq |= 1;
+	__atomic_store_n(&segment->sequence, seq, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(segment->magic, snapshot, SHM_MAGIC_SIZE);
+	memcpy((unsigned char *)segment + start, snapshot + start,
+	       SHM_SEGMENT_SIZE - start);
+
+	__atomic_store_n(&segment->sequence, seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * export_shm() - export the fields of a layout to a shared memory segment
+ * @layout:	The layout of the device
+ * @i2c_bus:	The bus of the device
+ * @i2c_addr:	The address of the device
+ *
+ * The segment is created if needed, and updated in place otherwise, so
+ * consumers which already mapped it see the new contents.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int export_shm(const struct layout *layout, int i2c_bus, int i2c_addr)
+{
+	ASSERT(layout && layout->fields);
+
+	unsigned char snapshot[SHM_SEGMENT_SIZE];
+	char name[SHM_NAME_MAX];
+	struct stat st;
+	int ret = -1;
+
+	if (build_snapshot(snapshot, layout, i2c_bus, i2c_addr) < 0)
+		return -1;
+
+	snprintf(name, SHM_NAME_MAX, "/eeprom-util-%d-00%02x", i2c_bus, i2c_addr);
+	int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		eprintf("Could not open shared memory segment %s (%s)\n", name,
+			strerror(errno));
+		return -1;
+	}
+
+	/* serialize concurrent exports of the same device */
+	if (flock(fd, LOCK_EX) < 0 || fstat(fd, &st) < 0)
+		goto done;
+
+	if (st.st_size != SHM_SEGMENT_SIZE &&
+	    ftruncate(fd, SHM_SEGMENT_SIZE) < 0)
+		goto done;
+
+	void *segment = mmap(NULL, SHM_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+			     MAP_SHARED, fd, 0);
+	if (segment == MAP_FAILED)
+		goto done;
+
+	publish(segment, snapshot);
+	munmap(segment, SHM_SEGMENT_SIZE);
+	ret = 0;
+
+done:
+	if (ret < 0)
+		eprintf("Could not export to %s (%s)\n", name, strerror(errno));
+
+	close(fd);
+	return ret;
+}
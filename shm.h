@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SHM_
+#define _SHM_
+
+/*
+ * The layout of the shared memory snapshot exported by "export-shm". This
+ * header is self contained, so consumers may include it as is.
+ *
+ * The segment is named "/eeprom-util-<bus>-00<addr>" (i.e. it is found at
+ * /dev/shm/eeprom-util-2-0050) and is always SHM_SEGMENT_SIZE bytes long.
+ * It begins with a struct shm_header, followed by num_fields descriptors,
+ * followed by the field values. Multi-byte values are little endian as
+ * stored in the EEPROM, except that values of reversed fields (i.e. the
+ * serial number) are stored in their natural order. ASCII values are NUL
+ * terminated and their size includes the terminator. Reserved fields are
+ * not exported.
+ *
+ * The segment is protected by a seqlock: sequence is odd while the segment
+ * is being updated. Readers copy what they need between shm_read_begin()
+ * and shm_read_retry(), and start over if the latter returns nonzero:
+ *
+ *	unsigned int seq;
+ *	do {
+ *		seq = shm_read_begin(header);
+ *		memcpy(mac, (char *)header + field->offset, 6);
+ *	} while (shm_read_retry(header, seq));
+ */
+
+#define SHM_MAGIC		"EEPS"
+#define SHM_MAGIC_SIZE		4
+#define SHM_VERSION		1
+#define SHM_SEGMENT_SIZE	4096
+#define SHM_NAME_SIZE		16
+
+struct shm_field {
+	char name[SHM_NAME_SIZE];	/* short name, i.e. "mac1" */
+	unsigned char type;		/* enum field_type */
+	unsigned char reserved;
+	unsigned short eeprom_offset;	/* offset of the field in the EEPROM */
+	unsigned short offset;		/* offset of the value in the segment */
+	unsigned short size;		/* size of the value */
+};
+
+struct shm_header {
+	char magic[SHM_MAGIC_SIZE];
+	unsigned int sequence;
+	unsigned short version;
+	unsigned short num_fields;
+	int layout_version;		/* enum layout_version */
+	int i2c_bus;
+	int i2c_addr;
+	struct shm_field fields[];
+};
+
+static inline unsigned int shm_read_begin(const struct shm_header *header)
+{
+	unsigned int seq;
+
+	while ((seq = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE)) & 1)
+		;
+
+	return seq;
+}
+
+static inline int shm_read_retry(const struct shm_header *header,
+				 unsigned int seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&header->sequence, __ATOMIC_RELAXED) != seq;
+}
+
+struct layout;
+
+int export_shm(const struct layout *layout, int i2c_bus, int i2c_addr);
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "common.h"
+#include "layout.h"
+#include "store.h"
+
+#define STORE_MAGIC		"EEPU"
+#define STORE_MAGIC_SIZE	4
+
+/*
+ * The on-disk image file: a small header followed by the raw EEPROM image.
+ */
+struct store_header {
+	char magic[STORE_MAGIC_SIZE];
+	unsigned short image_size;
+	signed char layout_version;	/* LAYOUT_AUTODETECT if unknown */
+	unsigned char reserved;
+};
+
+/* File names follow the naming of the EEPROM driver devices: <bus>-00<addr> */
+void store_path(char *dest, const char *dir, int i2c_bus, int i2c_addr)
+{
+	snprintf(dest, PATH_MAX, "%s/%d-00%02x", dir, i2c_bus, i2c_addr);
+}
+
+/*
+ * make_dirs() - create a directory and its missing parents
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int make_dirs(const char *dir)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s", dir);
+	for (char *c = path + 1; *c; c++) {
+		if (*c != '/')
+			continue;
+
+		*c = '\0';
+		if (mkdir(path, 0755) < 0 && errno != EEXIST)
+			return -1;
+		*c = '/';
+	}
+
+	if (mkdir(path, 0755) < 0 && errno != EEXIST)
+		return -1;
+
+	return 0;
+}
+
+int read_all(int fd, void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t ret = read(fd, (char *)buf + done, size - done);
+		if (ret <= 0)
+			return -1;
+		done += ret;
+	}
+
+	return 0;
+}
+
+static int write_all(int fd, const void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t ret = write(fd, (const char *)buf + done, size - done);
+		if (ret < 0)
+			return -1;
+		done += ret;
+	}
+
+	return 0;
+}
+
+/*
+ * store_load() - load the stored image of a device
+ * @dir:	The store directory
+ * @i2c_bus:	The bus of the device
+ * @i2c_addr:	The address of the device
+ * @buf:	Where to save the image. Must be at least EEPROM_SIZE bytes.
+ * @mtime:	Where to save the time the image was stored. May be NULL.
+ * @layout_version: Where to save the layout version which was detected for
+ *		the image, or LAYOUT_AUTODETECT if unknown. May be NULL.
+ *
+ * Returns: 0 on success, -1 if there's no valid stored image.
+ */
+int store_load(const char *dir, int i2c_bus, int i2c_addr,
+	       unsigned char *buf, time_t *mtime, int *layout_version)
+{
+	ASSERT(dir && buf);
+
+	char path[PATH_MAX];
+	struct store_header header;
+	struct stat st;
+	int ret = -1;
+
+	store_path(path, dir, i2c_bus, i2c_addr);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) < 0 || read_all(fd, &header, sizeof(header)) < 0)
+		goto done;
+
+	if (memcmp(header.magic, STORE_MAGIC, STORE_MAGIC_SIZE) ||
+	    header.image_size != EEPROM_SIZE)
+		goto done;
+
+	if (read_all(fd, buf, EEPROM_SIZE) < 0)
+		goto done;
+
+	if (mtime)
+		*mtime = st.st_mtime;
+
+	if (layout_version)
+		*layout_version = header.layout_version;
+
+	ret = 0;
+
+done:
+	close(fd);
+	return ret;
+}
+
+/* Make a rename in the directory of path durable */
+static int sync_parent_dir(const char *path)
+{
+	char dir[PATH_MAX];
+
+	snprintf(dir, PATH_MAX, "%s", path);
+	char *slash = strrchr(dir, '/');
+	if (!slash)
+		snprintf(dir, PATH_MAX, ".");
+	else if (slash == dir)
+		dir[1] = '\0';
+	else
+		*slash = '\0';
+
+	int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return -1;
+
+	int ret = fsync(fd);
+	close(fd);
+	return ret;
+}
+
+/*
+ * write_file_atomic() - replace a file with a header followed by data
+ * @path:	The file to replace
+ * @header:	The first part of the contents. May be NULL.
+ * @header_size: The size of header
+ * @data:	The second part of the contents
+ * @size:	The size of data
+ *
+ * The contents are written to a temporary file which is then renamed over
+ * the old one, so readers see either the old or the new contents. Both the
+ * file and the rename reach the disk before this returns.
+ *
+ * Returns: 0 on success, -1 on failure with errno set.
+ */
+int write_file_atomic(const char *path, const void *header, size_t header_size,
+		      const void *data, size_t size)
+{
+	ASSERT(path && data);
+
+	char tmp_path[PATH_MAX];
+	int saved_errno;
+
+	snprintf(tmp_path, PATH_MAX, "%s.tmp", path);
+	int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+
+	if ((header && write_all(fd, header, header_size) < 0) ||
+	    write_all(fd, data, size) < 0)
+		goto error;
+
+	if (fsync(fd) < 0)
+		goto error;
+
+	if (close(fd) < 0) {
+		fd = -1;
+		goto error;
+	}
+
+	if (rename(tmp_path, path) < 0) {
+		fd = -1;
+		goto error;
+	}
+
+	return sync_parent_dir(path);
+
+error:
+	saved_errno = errno;
+	if (fd >= 0)
+		close(fd);
+	unlink(tmp_path);
+	errno = saved_errno;
+	return -1;
+}
+
+/*
+ * store_save() - atomically replace the stored image of a device
+ * @dir:	The store directory. Created if it doesn't exist.
+ * @i2c_bus:	The bus of the device
+ * @i2c_addr:	The address of the device
+ * @buf:	The image to store. Must be EEPROM_SIZE bytes.
+ * @layout_version: The layout version detected for the image, or
+ *		LAYOUT_AUTODETECT if unknown.
+ *
+ * Returns: 0 on success, -1 on failure.
+ */
+int store_save(const char *dir, int i2c_bus, int i2c_addr,
+	       const unsigned char *buf, int layout_version)
+{
+	ASSERT(dir && buf);
+
+	char path[PATH_MAX];
+	struct store_header header = {
+		.magic		= STORE_MAGIC,
+		.image_size	= EEPROM_SIZE,
+		.layout_version	= layout_version,
+	};
+
+	if (make_dirs(dir) < 0)
+		goto error;
+
+	store_path(path, dir, i2c_bus, i2c_addr);
+	if (write_file_atomic(path, &header, sizeof(header),
+			      buf, EEPROM_SIZE) < 0)
+		goto error;
+
+	return 0;
+
+error:
+	eprintf("Failed storing image in %s: %s (%d)\n", dir,
+		strerror(errno), -errno);
+	return -1;
+}
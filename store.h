@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2009-2018 CompuLab, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _STORE_
+#define _STORE_
+
+#include <stddef.h>
+#include <time.h>
+
+#define DEFAULT_STORE_DIR	"/var/lib/eeprom-util"
+#define DEFAULT_CACHE_DIR	"/run/eeprom-util"
+#define DEFAULT_STORE_MAX_AGE	(7 * 24 * 60 * 60)
+
+void store_path(char *dest, const char *dir, int i2c_bus, int i2c_addr);
+int make_dirs(const char *dir);
+int read_all(int fd, void *buf, size_t size);
+int write_file_atomic(const char *path, const void *header, size_t header_size,
+		      const void *data, size_t size);
+int store_load(const char *dir, int i2c_bus, int i2c_addr,
+	       unsigned char *buf, time_t *mtime, int *layout_version);
+int store_save(const char *dir, int i2c_bus, int i2c_addr,
+	       const unsigned char *buf, int layout_version);
+
+#endif